@@ -6,11 +6,16 @@
 #include "alloc/alloc.h"
 
 #include <math.h>
-#include <stdarg.h>
+#include <pthread.h>
+#include <stdatomic.h>
 #include <stddef.h>
 #include <stdio.h>
 #include <string.h>
+#include <time.h>
 
+#include "alloc/event_log.h"
+#include "alloc/site.h"
+#include "alloc/tag.h"
 #include "debug/debug.h"
 #include "struct/map.h"
 #include "struct/set.h"
@@ -19,20 +24,80 @@
 typedef struct {
   uint32_t elt_size;
   uint32_t count;
-  uint32_t line;
-  char *type_name;
-  char *func;
-  char *file;
+  // See alloc/site.h.
+  uint32_t site_id;
+  // 0 for blocks with the default alignment. Otherwise log2 of the block's
+  // alignment, which is also how far the block is from the start of the
+  // underlying allocation.
+  uint8_t align_log2;
+  // True if allocated by ALLOC_ARRAY_LARGE().
+  bool large;
+  // Charged with the block's bytes. See alloc_tag_set().
+  AllocTag tag;
 } _AllocInfo;
 
-// Whether memory allocation events should be outputted to stdout.
-static bool _is_verbose = false;
-// Stores pointers to allocated memory.
-static Set *_in_mem = NULL;
-// Avoid self-initialized memory allocation within Set.
-static volatile bool _alloc_busy = false;
+// Number of independently-locked shards in the allocation registry is
+// 2^REGISTRY_SHARD_BITS.
+#define REGISTRY_SHARD_BITS 6
+#define REGISTRY_SHARDS (1 << REGISTRY_SHARD_BITS)
+// Mean bytes between samples in SAMPLE_MEMORY builds.
+#define DEFAULT_SAMPLE_INTERVAL (512 * 1024)
+
+// Number of counters in the sampled-block filter is 2^SAMPLED_FILTER_BITS.
+#define SAMPLED_FILTER_BITS 14
+
+// Considerably-large prime number. The registry holds roughly
+// REGISTRY_SHARDS * REGISTRY_SHARD_TABLE_SZ pointers before resizing.
+#define REGISTRY_SHARD_TABLE_SZ 521
+
+// One slice of the pointer registry. Each shard sits on its own cache line so
+// that threads registering pointers in different shards do not contend.
+typedef struct {
+  _Alignas(64) pthread_mutex_t lock;
+  Set in_mem;
+} _RegistryShard;
+
+// Stores pointers to allocated memory, sharded by pointer.
+static _RegistryShard _in_mem[REGISTRY_SHARDS];
+// Avoid self-initialized memory allocation within Set. Kept per-thread so that
+// one thread tidying up the registry does not cause others to skip it.
+static __thread bool _alloc_busy = false;
 // True if inited.
 static volatile bool _is_inited = false;
+// When alloc_init() was called, used to compute allocation rates.
+static struct timespec _init_time;
+// Mean bytes between samples. Fixed once alloc_init() is called so that the
+// weight of a sampled block is the same when it is freed.
+static size_t _sample_interval = DEFAULT_SAMPLE_INTERVAL;
+// Bytes left to allocate on this thread before the next sample is taken.
+static __thread int64_t _bytes_until_sample = 0;
+// State of this thread's xorshift generator. 0 until first used.
+static __thread uint64_t _sample_rng = 0;
+// Counts the live sampled blocks whose addresses hash to each slot. Unsampled
+// blocks in SAMPLE_MEMORY builds have no header, so this is how they are told
+// apart from sampled ones without taking a lock: a zero count means that the
+// block was not sampled, and otherwise the registry has the final say.
+//
+// Counts stick at UINT8_MAX rather than wrapping, which keeps the table small
+// enough to stay in L1 and only costs extra registry lookups.
+static _Atomic uint8_t _sampled_filter[1 << SAMPLED_FILTER_BITS];
+
+static void *_libc_calloc(size_t count, size_t size) {
+  return calloc(count, size);
+}
+static void *_libc_malloc(size_t size) { return malloc(size); }
+static void *_libc_realloc(void *ptr, size_t size) {
+  return realloc(ptr, size);
+}
+static void _libc_free(void *ptr) { free(ptr); }
+
+const AllocBackend ALLOC_LIBC_BACKEND = {.name = "libc",
+                                         .calloc = _libc_calloc,
+                                         .malloc = _libc_malloc,
+                                         .realloc = _libc_realloc,
+                                         .free = _libc_free};
+
+const AllocBackend *__alloc_backend = &ALLOC_LIBC_BACKEND;
 
 // Wraps calloc to match the Alloc typedef.
 void *_calloc(size_t count, size_t size, const char type[]) {
@@ -47,106 +112,352 @@ void _free(void **ptr) {
   free(*ptr);
 }
 
+// Selects the registry shard responsible for [ptr].
+//
+// The low bits of a heap pointer are mostly alignment, so they are discarded
+// and the remainder is scrambled with a Fibonacci hash.
+static inline _RegistryShard *_registry_shard(const void *ptr) {
+  uint64_t h = (uint64_t)(uintptr_t)ptr >> 4;
+  h *= 0x9E3779B97F4A7C15ull;
+  return &_in_mem[h >> (64 - REGISTRY_SHARD_BITS)];
+}
+
+// Returns the sampled-block filter counter for [ptr], hashed like
+// _registry_shard().
+static inline _Atomic uint8_t *_sampled_filter_slot(const void *ptr) {
+  uint64_t h = (uint64_t)(uintptr_t)ptr >> 4;
+  h *= 0x9E3779B97F4A7C15ull;
+  return &_sampled_filter[h >> (64 - SAMPLED_FILTER_BITS)];
+}
+
 void alloc_init() {
+  ASSERT(!_is_inited);
   _alloc_busy = true;
-  ASSERT_NULL(_in_mem);
-  _in_mem =
-      set_create(32781, default_hasher, default_comparator, _calloc, _free);
+  for (int i = 0; i < REGISTRY_SHARDS; ++i) {
+    pthread_mutex_init(&_in_mem[i].lock, NULL);
+    set_init(&_in_mem[i].in_mem, REGISTRY_SHARD_TABLE_SZ, default_hasher,
+             default_comparator, _calloc, _free);
+  }
   _alloc_busy = false;
+  clock_gettime(CLOCK_MONOTONIC, &_init_time);
   _is_inited = true;
 }
 
+void alloc_init_with_backend(const AllocBackend *backend) {
+  ASSERT(!_is_inited, NOT_NULL(backend));
+  __alloc_backend = backend;
+  alloc_init();
+}
+
 bool alloc_ready() { return _is_inited; }
 
 _AllocInfo _alloc_info(uint32_t elt_size, uint32_t count, uint32_t line,
                        const char type_name[], const char func[],
                        const char file[]) {
-  _AllocInfo info = {.elt_size = elt_size, .count = count, .line = line};
-  info.type_name = malloc(sizeof(char) * strlen(type_name) + 1);
-  strcpy(info.type_name, type_name);
-  info.func = malloc(sizeof(char) * strlen(func) + 1);
-  strcpy(info.func, func);
-  info.file = malloc(sizeof(char) * strlen(file) + 1);
-  strcpy(info.file, file);
+  _AllocInfo info = {
+      .elt_size = elt_size,
+      .count = count,
+      .site_id = alloc_site_intern_static(line, func, file, type_name)};
   return info;
 }
 
-void _alloc_info_delete(_AllocInfo *info, uint32_t line, const char func[],
-                        const char file[]) {
-  if (NULL == info || NULL == info->type_name || NULL == info->file) {
+// Returns the site for [info], failing if the header has been corrupted.
+const AllocSite *_alloc_info_site(const _AllocInfo *info, uint32_t line,
+                                  const char func[], const char file[]) {
+  const AllocSite *site = NULL == info ? NULL : alloc_site(info->site_id);
+  if (NULL == site) {
     __error(line, func, file, "Memory management error.");
   }
-  ASSERT(NOT_NULL(info), NOT_NULL(info->type_name), NOT_NULL(info->file),
-         NOT_NULL(info->func));
-  free(info->type_name);
-  free(info->file);
-  free(info->func);
+  return site;
+}
+
+// Space reserved before each block for its _AllocInfo. Rounded up so that
+// blocks keep the alignment that malloc guarantees.
+static inline int _alloc_info_size() {
+  return ((sizeof(_AllocInfo) + _Alignof(max_align_t) - 1) /
+          _Alignof(max_align_t)) *
+         _Alignof(max_align_t);
 }
 
-int _alloc_info_size() {
-  return ((int)ceil(((float)sizeof(_AllocInfo)) / 8)) * 8;
+// Returns the _AllocInfo for the block at [ptr].
+static inline _AllocInfo *_alloc_info_of(const void *ptr) {
+  return (_AllocInfo *)((char *)ptr - _alloc_info_size());
+}
+
+// Returns the start of the underlying allocation for the block at [ptr].
+static inline void *_alloc_info_base(const _AllocInfo *info, void *ptr) {
+  return (char *)ptr -
+         (0 == info->align_log2 ? _alloc_info_size() : 1 << info->align_log2);
+}
+
+// Frees the underlying allocation for the block at [ptr]. Aligned and large
+// blocks do not come from the backend.
+static inline void _alloc_info_free(const _AllocInfo *info, void *ptr) {
+  if (info->large) {
+    __large_free(ptr);
+  } else if (0 == info->align_log2) {
+    __alloc_backend->free(_alloc_info_base(info, ptr));
+  } else {
+    free(_alloc_info_base(info, ptr));
+  }
+}
+
+// Charges [info]'s bytes to [tag].
+static inline void _tag_charge(_AllocInfo *info, AllocTag tag) {
+  info->tag = tag;
+  alloc_tag_record(tag, (int64_t)info->elt_size * info->count);
+}
+
+// Charges [tag] with the change in size of a block that was [old_bytes] and
+// is now described by [info].
+static inline void _tag_recharge(_AllocInfo *info, AllocTag tag,
+                                 int64_t old_bytes) {
+  info->tag = tag;
+  alloc_tag_record(tag, (int64_t)info->elt_size * info->count - old_bytes);
+}
+
+// Returns [info]'s bytes to its tag.
+static inline void _tag_release(const _AllocInfo *info) {
+  alloc_tag_record(info->tag, -(int64_t)info->elt_size * info->count);
+}
+
+// Returns log2([align]), or -1 if [align] is not a power of 2.
+static int _align_log2(size_t align) {
+  if (0 == align || 0 != (align & (align - 1))) {
+    return -1;
+  }
+  int log2 = 0;
+  for (; ((size_t)1 << log2) < align; ++log2) {
+  }
+  return log2;
 }
 
 void alloc_finalize() {
-  volatile bool alloc_val = _alloc_busy;
+  ASSERT(_is_inited);
+  bool alloc_val = _alloc_busy;
   _alloc_busy = true;
-  ASSERT_NOT_NULL(_in_mem);
-  M_iter iter = set_iter(_in_mem);
-  for (; has(&iter); inc(&iter)) {
-    void *ptr = value(&iter);
-    ASSERT_NOT_NULL(ptr);
-    _AllocInfo *info = (_AllocInfo *)((char *)ptr - _alloc_info_size());
-    fprintf(stderr, "Forgot to free %p(%sx%d) allocated at %s:%d in %s(...)\n",
-            ptr, info->type_name, info->count, info->file, info->line,
-            info->func);
-    fflush(stderr);
-    DEALLOC(ptr);
-    _is_inited = false;
-  }
-  set_delete(_in_mem);
+  for (int i = 0; i < REGISTRY_SHARDS; ++i) {
+    _RegistryShard *shard = &_in_mem[i];
+    pthread_mutex_lock(&shard->lock);
+    M_iter iter = set_iter(&shard->in_mem);
+    for (; has(&iter); inc(&iter)) {
+      void *ptr = value(&iter);
+      ASSERT_NOT_NULL(ptr);
+      _AllocInfo *info = _alloc_info_of(ptr);
+      const AllocSite *site =
+          _alloc_info_site(info, __LINE__, __func__, __FILE__);
+      fprintf(stderr,
+              "Forgot to free %p(%sx%d) allocated at %s:%d in %s(...)\n", ptr,
+              site->type_name, info->count, site->file, site->line,
+              site->func);
+      fflush(stderr);
+      _alloc_info_free(info, ptr);
+    }
+    set_finalize(&shard->in_mem);
+    pthread_mutex_unlock(&shard->lock);
+    pthread_mutex_destroy(&shard->lock);
+  }
+  // Sites must outlive the log, which writes their definitions.
+  alloc_event_log_stop();
+  alloc_site_finalize();
+  _is_inited = false;
   _alloc_busy = alloc_val;
 }
 
 void _alloc_register(void *ptr, uint32_t elt_size, uint32_t count,
                      uint32_t line, const char func[], const char file[],
                      const char type_name[]) {
-  if (!_alloc_busy) {
-    _alloc_busy = true;
-    if (!set_insert(_in_mem, ptr)) {
-      __error(
-          line, func, file,
-          "Attempting to allocate %p(%sx%d), but it is already allocated.\n",
-          ptr, type_name, count);
-    }
-    _alloc_busy = false;
+  if (_alloc_busy) {
+    return;
   }
+  _alloc_busy = true;
+  _RegistryShard *shard = _registry_shard(ptr);
+  pthread_mutex_lock(&shard->lock);
+  bool inserted = set_insert(&shard->in_mem, ptr);
+  pthread_mutex_unlock(&shard->lock);
+  _alloc_busy = false;
+  if (!inserted) {
+    __error(line, func, file,
+            "Attempting to allocate %p(%sx%d), but it is already allocated.\n",
+            ptr, type_name, count);
+  }
+}
+
+// Removes [ptr] from the registry. Returns false if it was not registered.
+static bool _alloc_try_unregister(void *ptr) {
+  if (_alloc_busy) {
+    return true;
+  }
+  _alloc_busy = true;
+  _RegistryShard *shard = _registry_shard(ptr);
+  pthread_mutex_lock(&shard->lock);
+  bool removed = set_remove(&shard->in_mem, ptr);
+  pthread_mutex_unlock(&shard->lock);
+  _alloc_busy = false;
+  return removed;
 }
 
 void _alloc_unregister(void *ptr, uint32_t line, const char func[],
                        const char file[]) {
-  if (!_alloc_busy) {
-    _alloc_busy = true;
-    if (!set_remove(_in_mem, ptr)) {
-      __error(line, func, file,
-              "Attempting to free %p, but it is not allocated.\n", ptr);
-    }
-    _alloc_busy = false;
+  if (!_alloc_try_unregister(ptr)) {
+    __error(line, func, file,
+            "Attempting to free %p, but it is not allocated.\n", ptr);
+  }
+}
+
+bool alloc_log_start(const char path[]) { return alloc_event_log_start(path); }
+
+void alloc_log_stop() { alloc_event_log_stop(); }
+
+bool alloc_set_verbose(bool verbose) {
+  if (verbose) {
+    return alloc_log_start(ALLOC_DEFAULT_LOG_PATH);
+  }
+  alloc_log_stop();
+  return true;
+}
+
+void alloc_set_sample_interval(size_t bytes) {
+  ASSERT(!_is_inited);
+  _sample_interval = bytes;
+}
+
+typedef struct {
+  const AllocSite *site;
+  AllocSiteStats stats;
+} _ProfileRow;
+
+int _profile_row_compare(const void *lhs, const void *rhs) {
+  const AllocSiteStats *l = &((const _ProfileRow *)lhs)->stats;
+  const AllocSiteStats *r = &((const _ProfileRow *)rhs)->stats;
+  if (l->live_bytes != r->live_bytes) {
+    return l->live_bytes < r->live_bytes ? 1 : -1;
+  }
+  if (l->peak_bytes != r->peak_bytes) {
+    return l->peak_bytes < r->peak_bytes ? 1 : -1;
+  }
+  return 0;
+}
+
+void alloc_profile_dump(FILE *file) {
+  ASSERT_NOT_NULL(file);
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  double elapsed = (now.tv_sec - _init_time.tv_sec) +
+                   (now.tv_nsec - _init_time.tv_nsec) / 1e9;
+  uint32_t num_sites = alloc_site_count();
+  _ProfileRow *rows = malloc(sizeof(_ProfileRow) * (num_sites + 1));
+  ASSERT_NOT_NULL(rows);
+  uint64_t total_live = 0;
+  for (uint32_t i = 0; i < num_sites; ++i) {
+    rows[i].site = alloc_site(i + 1);
+    rows[i].stats = alloc_site_stats(i + 1);
+    total_live += rows[i].stats.live_bytes;
+  }
+  qsort(rows, num_sites, sizeof(_ProfileRow), _profile_row_compare);
+  fprintf(file, "Heap profile after %.3fs: %lu live bytes in %u sites.\n",
+          elapsed, (unsigned long)total_live, num_sites);
+  fprintf(file, "%12s %12s %10s %10s %12s  %s\n", "live_bytes", "peak_bytes",
+          "allocs", "frees", "allocs/s", "site");
+  for (uint32_t i = 0; i < num_sites; ++i) {
+    const AllocSite *site = rows[i].site;
+    const AllocSiteStats *stats = &rows[i].stats;
+    fprintf(file, "%12lu %12lu %10lu %10lu %12.1f  %s[] at %s:%d in %s(...)\n",
+            (unsigned long)stats->live_bytes, (unsigned long)stats->peak_bytes,
+            (unsigned long)stats->alloc_count,
+            (unsigned long)stats->free_count,
+            elapsed > 0 ? stats->alloc_count / elapsed : 0.0, site->type_name,
+            site->file, site->line, site->func);
+  }
+  fflush(file);
+  free(rows);
+}
+
+typedef struct {
+  int64_t live_bytes;
+  int64_t live_blocks;
+} _SnapshotSite;
+
+struct __AllocSnapshot {
+  struct timespec time;
+  uint32_t num_sites;
+  // Indexed by site id - 1.
+  _SnapshotSite sites[];
+};
+
+AllocSnapshot *alloc_snapshot() {
+  uint32_t num_sites = alloc_site_count();
+  AllocSnapshot *snapshot =
+      malloc(sizeof(AllocSnapshot) + sizeof(_SnapshotSite) * num_sites);
+  ASSERT_NOT_NULL(snapshot);
+  clock_gettime(CLOCK_MONOTONIC, &snapshot->time);
+  snapshot->num_sites = num_sites;
+  for (uint32_t i = 0; i < num_sites; ++i) {
+    AllocSiteStats stats = alloc_site_stats(i + 1);
+    snapshot->sites[i].live_bytes = stats.live_bytes;
+    snapshot->sites[i].live_blocks = stats.alloc_count - stats.free_count;
   }
+  return snapshot;
 }
 
-void alloc_set_verbose(bool verbose) { _is_verbose = verbose; }
+void alloc_snapshot_delete(AllocSnapshot *snapshot) { free(snapshot); }
 
-void _log_alloc(uint32_t line, const char func[], const char file[],
-                char format[], ...) {
-  if (_is_verbose) {
-    va_list args;
-    va_start(args, format);
-    fprintf(stdout, "At %s:%d in %s(...):\t", file, line, func);
-    vfprintf(stdout, format, args);
-    fprintf(stdout, "\n");
-    fflush(stdout);
-    va_end(args);
+typedef struct {
+  const AllocSite *site;
+  int64_t growth_bytes;
+  int64_t growth_blocks;
+  int64_t live_bytes;
+} _DiffRow;
+
+int _diff_row_compare(const void *lhs, const void *rhs) {
+  const _DiffRow *l = (const _DiffRow *)lhs;
+  const _DiffRow *r = (const _DiffRow *)rhs;
+  if (l->growth_bytes != r->growth_bytes) {
+    return l->growth_bytes < r->growth_bytes ? 1 : -1;
+  }
+  return 0;
+}
+
+void alloc_diff(const AllocSnapshot *before, const AllocSnapshot *after,
+                FILE *file) {
+  ASSERT(NOT_NULL(before), NOT_NULL(after), NOT_NULL(file));
+  double elapsed = (after->time.tv_sec - before->time.tv_sec) +
+                   (after->time.tv_nsec - before->time.tv_nsec) / 1e9;
+  _DiffRow *rows = malloc(sizeof(_DiffRow) * (after->num_sites + 1));
+  ASSERT_NOT_NULL(rows);
+  uint32_t num_rows = 0;
+  int64_t total_growth = 0;
+  for (uint32_t i = 0; i < after->num_sites; ++i) {
+    // Sites first seen after [before] was taken had nothing live then.
+    _SnapshotSite was = {0, 0};
+    if (i < before->num_sites) {
+      was = before->sites[i];
+    }
+    const _SnapshotSite *is = &after->sites[i];
+    total_growth += is->live_bytes - was.live_bytes;
+    if (is->live_bytes <= was.live_bytes) {
+      continue;
+    }
+    _DiffRow *row = &rows[num_rows++];
+    row->site = alloc_site(i + 1);
+    row->growth_bytes = is->live_bytes - was.live_bytes;
+    row->growth_blocks = is->live_blocks - was.live_blocks;
+    row->live_bytes = is->live_bytes;
+  }
+  qsort(rows, num_rows, sizeof(_DiffRow), _diff_row_compare);
+  fprintf(file, "Heap growth over %.3fs: %+ld bytes. %u of %u sites grew.\n",
+          elapsed, (long)total_growth, num_rows, after->num_sites);
+  fprintf(file, "%12s %12s %12s  %s\n", "grew_bytes", "grew_blocks",
+          "live_bytes", "site");
+  for (uint32_t i = 0; i < num_rows; ++i) {
+    const AllocSite *site = rows[i].site;
+    fprintf(file, "%12ld %12ld %12ld  %s[] at %s:%d in %s(...)\n",
+            (long)rows[i].growth_bytes, (long)rows[i].growth_blocks,
+            (long)rows[i].live_bytes, site->type_name, site->file,
+            site->line, site->func);
   }
+  fflush(file);
+  free(rows);
 }
 
 // Allocates a new block of memory and registers it.
@@ -158,7 +469,7 @@ void *__alloc(uint32_t elt_size, uint32_t count, uint32_t line,
             " an array of type sizeof(0).");
   }
   int info_space = _alloc_info_size();
-  void *info_ptr = calloc(1, info_space + count * elt_size);
+  void *info_ptr = __alloc_backend->calloc(1, info_space + count * elt_size);
   ASSERT(NOT_NULL(info_ptr));
   *((_AllocInfo *)info_ptr) =
       _alloc_info(elt_size, count, line, type_name, func, file);
@@ -166,9 +477,12 @@ void *__alloc(uint32_t elt_size, uint32_t count, uint32_t line,
     __error(line, func, file, "Failed to allocate memory.");
   }
   void *ptr = (char *)info_ptr + info_space;
+  _tag_charge((_AllocInfo *)info_ptr, alloc_tag_current());
+  alloc_site_record_alloc(((_AllocInfo *)info_ptr)->site_id, count * elt_size,
+                          1);
   _alloc_register(ptr, elt_size, count, line, func, file, type_name);
-  _log_alloc(line, func, file, "Allocated a %s[%d] at %p", type_name, count,
-             ptr);
+  alloc_event_log_record(ALLOC_EVENT_ALLOC, ptr, NULL, count * elt_size,
+                         ((_AllocInfo *)info_ptr)->site_id);
   return ptr;
 }
 
@@ -185,25 +499,40 @@ void *__realloc(void *ptr, uint32_t elt_size, uint32_t count, uint32_t line,
   int info_space = _alloc_info_size();
   void *info_ptr = (char *)ptr - info_space;
   _AllocInfo old_info = *((_AllocInfo *)((char *)ptr - info_space));
+  if (0 != old_info.align_log2) {
+    __error(line, func, file,
+            "Cannot reallocate %p because it was allocated aligned.", ptr);
+  }
+  if (old_info.large) {
+    __error(line, func, file,
+            "%p was allocated with ALLOC_ARRAY_LARGE(). Use REALLOC_LARGE().",
+            ptr);
+  }
   int old_size = old_info.elt_size * old_info.count;
-  void *new_info_ptr = realloc(info_ptr, info_space + new_size);
+  // Unregister before the block is released so another thread cannot be
+  // handed the same address and register it first.
+  _alloc_unregister(ptr, line, func, file);
+  void *new_info_ptr =
+      __alloc_backend->realloc(info_ptr, info_space + new_size);
   if (NULL == new_info_ptr) {
     __error(line, func, file, "Failed to reallocate memory.");
   }
+  const AllocSite *old_site = _alloc_info_site(&old_info, line, func, file);
   *((_AllocInfo *)new_info_ptr) =
-      _alloc_info(elt_size, count, line, old_info.type_name, func, file);
+      _alloc_info(elt_size, count, line, old_site->type_name, func, file);
   void *new_ptr = (char *)new_info_ptr + info_space;
+  _tag_recharge((_AllocInfo *)new_info_ptr, old_info.tag, old_size);
+  alloc_site_record_free(old_info.site_id, old_size, 1);
+  alloc_site_record_alloc(((_AllocInfo *)new_info_ptr)->site_id, new_size, 1);
   if (new_size > old_size) {
     size_t diff = new_size - old_size;
     void *start = ((char *)new_ptr) + old_size;
     memset(start, 0, diff);
   }
-  _alloc_info_delete(&old_info, line, func, file);
-  _alloc_unregister(ptr, line, func, file);
   _alloc_register(new_ptr, elt_size, count, line, func, file,
-                  ((_AllocInfo *)new_info_ptr)->type_name);
-  _log_alloc(line, func, file, "Reallocated memory from %p to %p.", ptr,
-             new_ptr);
+                  old_site->type_name);
+  alloc_event_log_record(ALLOC_EVENT_REALLOC, new_ptr, ptr, new_size,
+                         ((_AllocInfo *)new_info_ptr)->site_id);
   return new_ptr;
 }
 
@@ -215,10 +544,201 @@ void __dealloc(void **ptr, uint32_t line, const char func[],
   }
   int info_space = _alloc_info_size();
   void *info_ptr = *((char **)ptr) - info_space;
-  _alloc_info_delete((_AllocInfo *)info_ptr, line, func, file);
-  free(info_ptr);
+  _AllocInfo *info = (_AllocInfo *)info_ptr;
+  _alloc_info_site(info, line, func, file);
+  if (info->large) {
+    __error(line, func, file,
+            "%p was allocated with ALLOC_ARRAY_LARGE(). Use DEALLOC_LARGE().",
+            *ptr);
+  }
   _alloc_unregister(*ptr, line, func, file);
-  _log_alloc(line, func, file, "Deallocated memory from %p", *ptr);
+  _tag_release(info);
+  alloc_site_record_free(info->site_id, info->elt_size * info->count, 1);
+  // Recorded before the block is released so that it cannot be logged after
+  // another thread is handed the same address.
+  alloc_event_log_record(ALLOC_EVENT_DEALLOC, *ptr, NULL,
+                         info->elt_size * info->count, info->site_id);
+  _alloc_info_free(info, *ptr);
+  *ptr = NULL;
+}
+
+// Allocates [size] cleared bytes aligned to [align] with posix_memalign().
+static void *_aligned_calloc(size_t align, size_t size) {
+  void *block = NULL;
+  if (0 != posix_memalign(&block, align, size)) {
+    return NULL;
+  }
+  memset(block, 0, size);
+  return block;
+}
+
+void *__aligned_calloc(size_t align, size_t size) {
+  // posix_memalign() also requires a multiple of sizeof(void *).
+  if (_align_log2(align) < 0) {
+    return NULL;
+  }
+  return _aligned_calloc(align < sizeof(void *) ? sizeof(void *) : align,
+                         size);
+}
+
+// Allocates an aligned block with an _AllocInfo header right before it.
+//
+// The block is offset from the start of the allocation by its alignment so
+// that the header fits in front of it and the block stays aligned.
+static void *_alloc_aligned_block(uint32_t elt_size, uint32_t count,
+                                  size_t align, uint32_t line,
+                                  const char func[], const char file[]) {
+  int align_log2 = _align_log2(align);
+  if (align_log2 < 0) {
+    __error(line, func, file, "Alignment %lu is not a power of 2.",
+            (unsigned long)align);
+  }
+  if (align < _alloc_info_size()) {
+    align = _alloc_info_size();
+    align_log2 = _align_log2(align);
+  }
+  char *base = _aligned_calloc(align, align + (size_t)elt_size * count);
+  if (NULL == base) {
+    __error(line, func, file, "Failed to allocate memory.");
+  }
+  void *ptr = base + align;
+  _AllocInfo *info = _alloc_info_of(ptr);
+  info->elt_size = elt_size;
+  info->count = count;
+  info->site_id = ALLOC_NO_SITE;
+  info->align_log2 = align_log2;
+  info->tag = ALLOC_TAG_NONE;
+  return ptr;
+}
+
+// Allocates a new aligned block of memory and registers it.
+void *__alloc_aligned(uint32_t elt_size, uint32_t count, size_t align,
+                      uint32_t line, const char func[], const char file[],
+                      const char type_name[]) {
+  if (0 == elt_size || 0 == count) {
+    __error(line, func, file,
+            "Either allocated array is of 0 elements or it is"
+            " an array of type sizeof(0).");
+  }
+  void *ptr = _alloc_aligned_block(elt_size, count, align, line, func, file);
+  _AllocInfo *info = _alloc_info_of(ptr);
+  _tag_charge(info, alloc_tag_current());
+  info->site_id = alloc_site_intern_static(line, func, file, type_name);
+  alloc_site_record_alloc(info->site_id, count * elt_size, 1);
+  _alloc_register(ptr, elt_size, count, line, func, file, type_name);
+  alloc_event_log_record(ALLOC_EVENT_ALLOC, ptr, NULL, count * elt_size,
+                         info->site_id);
+  return ptr;
+}
+
+// Maps a large block with an untracked _AllocInfo header.
+static void *_alloc_large_block(uint32_t elt_size, uint32_t count, bool huge,
+                                uint32_t line, const char func[],
+                                const char file[]) {
+  if (0 == elt_size || 0 == count) {
+    __error(line, func, file,
+            "Either allocated array is of 0 elements or it is"
+            " an array of type sizeof(0).");
+  }
+  void *ptr = __large_alloc((size_t)elt_size * count, huge);
+  if (NULL == ptr) {
+    __error(line, func, file, "Failed to allocate memory.");
+  }
+  _AllocInfo *info = _alloc_info_of(ptr);
+  info->elt_size = elt_size;
+  info->count = count;
+  info->site_id = ALLOC_NO_SITE;
+  info->align_log2 = 0;
+  info->large = true;
+  info->tag = ALLOC_TAG_NONE;
+  return ptr;
+}
+
+// Remaps a large block, leaving its _AllocInfo untracked. Fails if [ptr] is
+// not a large block.
+static void *_realloc_large_block(void *ptr, uint32_t elt_size, uint32_t count,
+                                  uint32_t line, const char func[],
+                                  const char file[]) {
+  if (!_alloc_info_of(ptr)->large) {
+    __error(line, func, file,
+            "%p was not allocated with ALLOC_ARRAY_LARGE(). Use REALLOC().",
+            ptr);
+  }
+  if (0 == elt_size || 0 == count) {
+    __error(line, func, file, "Tried to realloc to an empty array.");
+  }
+  void *new_ptr = __large_realloc(ptr, (size_t)elt_size * count);
+  if (NULL == new_ptr) {
+    __error(line, func, file, "Failed to reallocate memory.");
+  }
+  _AllocInfo *info = _alloc_info_of(new_ptr);
+  info->elt_size = elt_size;
+  info->count = count;
+  info->site_id = ALLOC_NO_SITE;
+  return new_ptr;
+}
+
+// Allocates a new large block and registers it.
+void *__alloc_large(uint32_t elt_size, uint32_t count, bool huge,
+                    uint32_t line, const char func[], const char file[],
+                    const char type_name[]) {
+  void *ptr = _alloc_large_block(elt_size, count, huge, line, func, file);
+  _AllocInfo *info = _alloc_info_of(ptr);
+  size_t size = (size_t)elt_size * count;
+  _tag_charge(info, alloc_tag_current());
+  info->site_id = alloc_site_intern_static(line, func, file, type_name);
+  alloc_site_record_alloc(info->site_id, size, 1);
+  _alloc_register(ptr, elt_size, count, line, func, file, type_name);
+  alloc_event_log_record(ALLOC_EVENT_ALLOC, ptr, NULL, size, info->site_id);
+  return ptr;
+}
+
+// Resizes a large block and re-registers it.
+void *__realloc_large(void *ptr, uint32_t elt_size, uint32_t count,
+                      uint32_t line, const char func[], const char file[]) {
+  if (NULL == ptr) {
+    __error(line, func, file, "Pointer argument was null.");
+  }
+  _AllocInfo old_info = *_alloc_info_of(ptr);
+  const AllocSite *old_site = _alloc_info_site(&old_info, line, func, file);
+  _alloc_unregister(ptr, line, func, file);
+  void *new_ptr = _realloc_large_block(ptr, elt_size, count, line, func, file);
+  _AllocInfo *info = _alloc_info_of(new_ptr);
+  size_t size = (size_t)elt_size * count;
+  _tag_recharge(info, old_info.tag,
+                (int64_t)old_info.elt_size * old_info.count);
+  info->site_id =
+      alloc_site_intern_static(line, func, file, old_site->type_name);
+  alloc_site_record_free(old_info.site_id,
+                         (size_t)old_info.elt_size * old_info.count, 1);
+  alloc_site_record_alloc(info->site_id, size, 1);
+  _alloc_register(new_ptr, elt_size, count, line, func, file,
+                  old_site->type_name);
+  alloc_event_log_record(ALLOC_EVENT_REALLOC, new_ptr, ptr, size,
+                         info->site_id);
+  return new_ptr;
+}
+
+// Unmaps a large block and unregisters it.
+void __dealloc_large(void **ptr, uint32_t line, const char func[],
+                     const char file[]) {
+  if (NULL == ptr || NULL == *ptr) {
+    __error(line, func, file, "Pointer argument was null.");
+  }
+  _AllocInfo *info = _alloc_info_of(*ptr);
+  _alloc_info_site(info, line, func, file);
+  if (!info->large) {
+    __error(line, func, file,
+            "%p was not allocated with ALLOC_ARRAY_LARGE(). Use DEALLOC().",
+            *ptr);
+  }
+  size_t size = (size_t)info->elt_size * info->count;
+  _alloc_unregister(*ptr, line, func, file);
+  _tag_release(info);
+  alloc_site_record_free(info->site_id, size, 1);
+  alloc_event_log_record(ALLOC_EVENT_DEALLOC, *ptr, NULL, size,
+                         info->site_id);
+  __large_free(*ptr);
   *ptr = NULL;
 }
 
@@ -228,7 +748,391 @@ char *__strndup(char *str, size_t len, uint32_t line, const char func[],
   if (NULL == str) {
     __error(line, func, file, "Pointer argument was null.");
   }
-  char *cpy = ALLOC_ARRAY2(char, len + 1);
+  // Attribute the copy to the caller rather than to this function.
+  char *cpy = (char *)__alloc(sizeof(char), len + 1, line, func, file, "char");
+  cpy[len] = '\0';
+  return strncpy(cpy, str, len);
+}
+
+// Returns a uniformly-distributed value in [0, 1).
+double _sample_uniform() {
+  if (0 == _sample_rng) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    _sample_rng = ((uint64_t)(uintptr_t)&_sample_rng * 0x9E3779B97F4A7C15ull) ^
+                  (uint64_t)now.tv_nsec ^ 1;
+  }
+  _sample_rng ^= _sample_rng << 13;
+  _sample_rng ^= _sample_rng >> 7;
+  _sample_rng ^= _sample_rng << 17;
+  return (_sample_rng >> 11) * 0x1.0p-53;
+}
+
+// Returns the number of bytes to allocate before taking the next sample.
+//
+// Drawing this from an exponential distribution makes the samples a Poisson
+// process over allocated bytes, so every byte is equally likely to be sampled
+// regardless of the size of the allocation it is part of.
+int64_t _next_sample_countdown() {
+  if (0 == _sample_interval) {
+    return 0;
+  }
+  return (int64_t)(-log(1.0 - _sample_uniform()) * _sample_interval) + 1;
+}
+
+// Draws the next countdown once this thread's has run out. Returns true if the
+// allocation of [bytes] that ran it out should be sampled.
+//
+// Kept out of _should_sample() so that the common case stays small.
+bool _sample_countdown_expired(size_t bytes) {
+  // The first allocation on each thread only seeds the countdown.
+  bool is_first = (0 == _sample_rng) && (0 != _sample_interval);
+  _bytes_until_sample = _next_sample_countdown();
+  // Sampled blocks must be registered, which cannot happen from inside the
+  // registry.
+  if (_alloc_busy) {
+    return false;
+  }
+  if (is_first) {
+    _bytes_until_sample -= bytes;
+    if (_bytes_until_sample > 0) {
+      return false;
+    }
+    _bytes_until_sample = _next_sample_countdown();
+  }
+  return true;
+}
+
+// Returns true if the next allocation of [bytes] should be sampled.
+static inline bool _should_sample(size_t bytes) {
+  _bytes_until_sample -= bytes;
+  return _bytes_until_sample <= 0 && _sample_countdown_expired(bytes);
+}
+
+// Returns the number of allocations of [bytes] that a sample of that size
+// represents, i.e., the inverse of the probability that it was sampled.
+static double _sample_weight(size_t bytes) {
+  if (0 == _sample_interval || 0 == bytes) {
+    return 1.0;
+  }
+  return 1.0 / (1.0 - exp(-(double)bytes / _sample_interval));
+}
+
+// Adds [delta] to the sampled-block filter count for [ptr], unless the count
+// is stuck at UINT8_MAX.
+static void _sampled_filter_add(const void *ptr, int delta) {
+  _Atomic uint8_t *slot = _sampled_filter_slot(ptr);
+  uint8_t count = atomic_load_explicit(slot, memory_order_relaxed);
+  while (UINT8_MAX != count &&
+         !atomic_compare_exchange_weak_explicit(slot, &count, count + delta,
+                                                memory_order_relaxed,
+                                                memory_order_relaxed)) {
+  }
+}
+
+// Starts tracking a block that was chosen to be sampled, charging its site
+// and [tag] with the bytes that it stands in for. [old_tag_bytes] is what
+// [tag] was already charged for the block, if it was sampled before being
+// reallocated.
+static void _sample_track(_AllocInfo *info, AllocTag tag, int64_t old_tag_bytes,
+                          void *ptr, uint32_t line, const char func[],
+                          const char file[], const char type_name[]) {
+  size_t bytes = (size_t)info->elt_size * info->count;
+  double weight = _sample_weight(bytes);
+  info->site_id = alloc_site_intern_static(line, func, file, type_name);
+  info->tag = tag;
+  alloc_site_record_alloc(info->site_id, llround(bytes * weight),
+                          llround(weight));
+  alloc_tag_record(tag, llround(bytes * weight) - old_tag_bytes);
+  _alloc_register(ptr, info->elt_size, info->count, line, func, file,
+                  type_name);
+  _sampled_filter_add(ptr, 1);
+}
+
+// Undoes _sample_track() for the sampled block at [ptr], which must already
+// be unregistered, apart from its tag. Returns the bytes that its tag was
+// charged.
+static int64_t _sample_untrack(const _AllocInfo *info, void *ptr) {
+  size_t bytes = (size_t)info->elt_size * info->count;
+  double weight = _sample_weight(bytes);
+  alloc_site_record_free(info->site_id, llround(bytes * weight),
+                         llround(weight));
+  _sampled_filter_add(ptr, -1);
+  return llround(bytes * weight);
+}
+
+// Returns false if [ptr] was certainly not sampled. Otherwise the registry
+// has the final say.
+//
+// Unsampled blocks almost always miss in the filter, so freeing them does not
+// touch the registry.
+static inline bool _maybe_sampled(const void *ptr) {
+  return 0 !=
+         atomic_load_explicit(_sampled_filter_slot(ptr), memory_order_relaxed);
+}
+
+// Fills in the _AllocInfo at the start of [info_ptr] for an untracked block
+// from the backend.
+static _AllocInfo *_sample_info_init(void *info_ptr, uint32_t elt_size,
+                                     uint32_t count) {
+  _AllocInfo *info = (_AllocInfo *)info_ptr;
+  info->elt_size = elt_size;
+  info->count = count;
+  info->site_id = ALLOC_NO_SITE;
+  info->align_log2 = 0;
+  info->large = false;
+  info->tag = ALLOC_TAG_NONE;
+  return info;
+}
+
+// Allocates a block with an _AllocInfo header and tracks it.
+void *_sampled_alloc_tracked(uint32_t elt_size, uint32_t count, bool clear,
+                             uint32_t line, const char func[],
+                             const char file[], const char type_name[]) {
+  size_t size = (size_t)elt_size * count;
+  int info_space = _alloc_info_size();
+  void *info_ptr = clear ? __alloc_backend->calloc(1, info_space + size)
+                         : __alloc_backend->malloc(info_space + size);
+  if (NULL == info_ptr) {
+    __error(line, func, file, "Failed to allocate memory.");
+  }
+  _AllocInfo *info = _sample_info_init(info_ptr, elt_size, count);
+  void *ptr = (char *)info_ptr + info_space;
+  _sample_track(info, alloc_tag_current(), 0, ptr, line, func, file,
+                type_name);
+  alloc_event_log_record(ALLOC_EVENT_ALLOC, ptr, NULL, size, info->site_id);
+  return ptr;
+}
+
+// Allocates a block, tracking it only if it is sampled.
+//
+// Only sampled blocks are given an _AllocInfo header, so unsampled blocks cost
+// about the same as in a build without SAMPLE_MEMORY.
+void *__sampled_alloc(uint32_t elt_size, uint32_t count, bool clear,
+                      uint32_t line, const char func[], const char file[],
+                      const char type_name[]) {
+  size_t size = (size_t)elt_size * count;
+  if (_should_sample(size)) {
+    return _sampled_alloc_tracked(elt_size, count, clear, line, func, file,
+                                  type_name);
+  }
+  void *ptr =
+      clear ? __alloc_backend->calloc(1, size) : __alloc_backend->malloc(size);
+  if (NULL == ptr) {
+    __error(line, func, file, "Failed to allocate memory.");
+  }
+  ALLOC_EVENT_LOG_RECORD(ALLOC_EVENT_ALLOC, ptr, NULL, size, ALLOC_NO_SITE);
+  return ptr;
+}
+
+// Reallocates a block from __sampled_alloc().
+//
+// Sampled blocks stay sampled. Otherwise the new size is counted towards the
+// next sample as if it were a new allocation, so blocks that grow can become
+// sampled.
+void *__sampled_realloc(void *ptr, uint32_t elt_size, uint32_t count,
+                        uint32_t line, const char func[], const char file[]) {
+  if (NULL == ptr) {
+    return __sampled_alloc(elt_size, count, /*clear=*/false, line, func, file,
+                           "void");
+  }
+  size_t size = (size_t)elt_size * count;
+  int info_space = _alloc_info_size();
+  AllocTag tag = alloc_tag_current();
+  int64_t old_tag_bytes = 0;
+  const char *type_name = "void";
+  char *info_ptr;
+  if (_maybe_sampled(ptr) && _alloc_try_unregister(ptr)) {
+    _AllocInfo old_info = *_alloc_info_of(ptr);
+    if (0 != old_info.align_log2) {
+      __error(line, func, file,
+              "Cannot reallocate %p because it was allocated aligned.", ptr);
+    }
+    if (old_info.large) {
+      __error(line, func, file,
+              "%p was allocated with ALLOC_ARRAY_LARGE(). Use REALLOC_LARGE().",
+              ptr);
+    }
+    tag = old_info.tag;
+    type_name = _alloc_info_site(&old_info, line, func, file)->type_name;
+    old_tag_bytes = _sample_untrack(&old_info, ptr);
+    info_ptr =
+        __alloc_backend->realloc((char *)ptr - info_space, info_space + size);
+    if (NULL == info_ptr) {
+      __error(line, func, file, "Failed to reallocate memory.");
+    }
+  } else if (!_should_sample(size)) {
+    void *new_ptr = __alloc_backend->realloc(ptr, size);
+    if (NULL == new_ptr) {
+      __error(line, func, file, "Failed to reallocate memory.");
+    }
+    ALLOC_EVENT_LOG_RECORD(ALLOC_EVENT_REALLOC, new_ptr, ptr, size,
+                           ALLOC_NO_SITE);
+    return new_ptr;
+  } else {
+    // The block has no header, so make room for one in front of its contents.
+    info_ptr = __alloc_backend->realloc(ptr, info_space + size);
+    if (NULL == info_ptr) {
+      __error(line, func, file, "Failed to reallocate memory.");
+    }
+    memmove(info_ptr + info_space, info_ptr, size);
+  }
+  _AllocInfo *info = _sample_info_init(info_ptr, elt_size, count);
+  void *new_ptr = info_ptr + info_space;
+  _sample_track(info, tag, old_tag_bytes, new_ptr, line, func, file,
+                type_name);
+  alloc_event_log_record(ALLOC_EVENT_REALLOC, new_ptr, ptr, size,
+                         info->site_id);
+  return new_ptr;
+}
+
+// Untracks and frees [ptr] if it was sampled. Returns false, leaving [ptr] to
+// the caller, if it was not.
+bool _sampled_release(void *ptr) {
+  if (!_alloc_try_unregister(ptr)) {
+    return false;
+  }
+  _AllocInfo *info = _alloc_info_of(ptr);
+  alloc_tag_record(info->tag, -_sample_untrack(info, ptr));
+  alloc_event_log_record(ALLOC_EVENT_DEALLOC, ptr, NULL,
+                         (size_t)info->elt_size * info->count, info->site_id);
+  _alloc_info_free(info, ptr);
+  return true;
+}
+
+// Frees a block from __sampled_alloc(), untracking it if it was sampled.
+//
+// The size of an unsampled block is not known, so its event is logged with a
+// size of 0.
+void __sampled_dealloc(void *ptr) {
+  if (NULL == ptr || (_maybe_sampled(ptr) && _sampled_release(ptr))) {
+    return;
+  }
+  // Recorded before the block is released so that it cannot be logged after
+  // another thread is handed the same address.
+  ALLOC_EVENT_LOG_RECORD(ALLOC_EVENT_DEALLOC, ptr, NULL, 0, ALLOC_NO_SITE);
+  __alloc_backend->free(ptr);
+}
+
+// Allocates an aligned block, tracking it only if it is sampled. Like
+// __sampled_alloc(), only sampled blocks have an _AllocInfo header.
+void *__sampled_alloc_aligned(uint32_t elt_size, uint32_t count, size_t align,
+                              uint32_t line, const char func[],
+                              const char file[], const char type_name[]) {
+  size_t size = (size_t)elt_size * count;
+  if (!_should_sample(size)) {
+    if (_align_log2(align) < 0) {
+      __error(line, func, file, "Alignment %lu is not a power of 2.",
+              (unsigned long)align);
+    }
+    void *ptr = __aligned_calloc(align, size);
+    if (NULL == ptr) {
+      __error(line, func, file, "Failed to allocate memory.");
+    }
+    ALLOC_EVENT_LOG_RECORD(ALLOC_EVENT_ALLOC, ptr, NULL, size, ALLOC_NO_SITE);
+    return ptr;
+  }
+  void *ptr = _alloc_aligned_block(elt_size, count, align, line, func, file);
+  _AllocInfo *info = _alloc_info_of(ptr);
+  _sample_track(info, alloc_tag_current(), 0, ptr, line, func, file,
+                type_name);
+  alloc_event_log_record(ALLOC_EVENT_ALLOC, ptr, NULL, size, info->site_id);
+  return ptr;
+}
+
+// Frees a block from __sampled_alloc_aligned(), untracking it if it was
+// sampled.
+void __sampled_dealloc_aligned(void *ptr) {
+  if (NULL == ptr || (_maybe_sampled(ptr) && _sampled_release(ptr))) {
+    return;
+  }
+  ALLOC_EVENT_LOG_RECORD(ALLOC_EVENT_DEALLOC, ptr, NULL, 0, ALLOC_NO_SITE);
+  free(ptr);
+}
+
+// Maps a large block, tracking it only if it is sampled.
+//
+// Unlike other blocks, every large block has an _AllocInfo header, since its
+// mapping already has room for one.
+void *__sampled_alloc_large(uint32_t elt_size, uint32_t count, bool huge,
+                            uint32_t line, const char func[],
+                            const char file[], const char type_name[]) {
+  void *ptr = _alloc_large_block(elt_size, count, huge, line, func, file);
+  _AllocInfo *info = _alloc_info_of(ptr);
+  size_t size = (size_t)elt_size * count;
+  if (_should_sample(size)) {
+    _sample_track(info, alloc_tag_current(), 0, ptr, line, func, file,
+                  type_name);
+  }
+  alloc_event_log_record(ALLOC_EVENT_ALLOC, ptr, NULL, size, info->site_id);
+  return ptr;
+}
+
+// Remaps a large block. Like __sampled_realloc(), growth counts towards the
+// next sample.
+void *__sampled_realloc_large(void *ptr, uint32_t elt_size, uint32_t count,
+                              uint32_t line, const char func[],
+                              const char file[]) {
+  if (NULL == ptr) {
+    return __sampled_alloc_large(elt_size, count, /*huge=*/false, line, func,
+                                 file, "void");
+  }
+  _AllocInfo old_info = *_alloc_info_of(ptr);
+  AllocTag tag = alloc_tag_current();
+  int64_t old_tag_bytes = 0;
+  const char *type_name = "void";
+  if (ALLOC_NO_SITE != old_info.site_id) {
+    tag = old_info.tag;
+    type_name = _alloc_info_site(&old_info, line, func, file)->type_name;
+    _alloc_unregister(ptr, line, func, file);
+    old_tag_bytes = _sample_untrack(&old_info, ptr);
+  }
+  void *new_ptr = _realloc_large_block(ptr, elt_size, count, line, func, file);
+  _AllocInfo *info = _alloc_info_of(new_ptr);
+  size_t size = (size_t)elt_size * count;
+  // Blocks that were sampled stay sampled without running down the countdown.
+  if (ALLOC_NO_SITE != old_info.site_id || _should_sample(size)) {
+    _sample_track(info, tag, old_tag_bytes, new_ptr, line, func, file,
+                  type_name);
+  }
+  alloc_event_log_record(ALLOC_EVENT_REALLOC, new_ptr, ptr, size,
+                         info->site_id);
+  return new_ptr;
+}
+
+// Unmaps a large block, untracking it if it was sampled.
+void __sampled_dealloc_large(void *ptr) {
+  if (NULL == ptr) {
+    return;
+  }
+  _AllocInfo *info = _alloc_info_of(ptr);
+  if (ALLOC_NO_SITE != info->site_id) {
+    _alloc_unregister(ptr, __LINE__, __func__, __FILE__);
+    alloc_tag_record(info->tag, -_sample_untrack(info, ptr));
+  }
+  alloc_event_log_record(ALLOC_EVENT_DEALLOC, ptr, NULL,
+                         (size_t)info->elt_size * info->count, info->site_id);
+  __large_free(ptr);
+}
+
+// Copies a string into a block from __sampled_alloc().
+char *__sampled_strndup(char *str, size_t len, uint32_t line,
+                        const char func[], const char file[]) {
+  if (NULL == str) {
+    __error(line, func, file, "Pointer argument was null.");
+  }
+  char *cpy = (char *)__sampled_alloc(sizeof(char), len + 1, /*clear=*/false,
+                                      line, func, file, "char");
+  cpy[len] = '\0';
+  return strncpy(cpy, str, len);
+}
+
+// Copies a string into a block from the backend.
+char *__backend_strndup(const char *str, size_t len) {
+  char *cpy = (char *)__alloc_backend->malloc(len + 1);
+  if (NULL == cpy) {
+    return NULL;
+  }
   cpy[len] = '\0';
   return strncpy(cpy, str, len);
 }
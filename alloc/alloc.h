@@ -2,24 +2,184 @@
 //
 // Created on: Sep 28, 2016
 //     Author: Jeff Manzione
+//
+// Wraps memory allocation so that it can be tracked.
+//
+// Build flags:
+//   - DEBUG_MEMORY: Every block is tracked with the call site that allocated
+//     it. Leaks are reported by alloc_finalize().
+//   - SAMPLE_MEMORY: Roughly one allocation per alloc_set_sample_interval()
+//     bytes is tracked, and alloc_profile_dump() reports statistically-scaled
+//     estimates. Only sampled blocks have a header, so as without either
+//     flag, each block must be freed by the DEALLOC*() that matches how it
+//     was allocated. An unsampled block costs an extra call and a few loads
+//     over the backend, about 3ns per allocation and free, which is small
+//     next to most work done with the memory but not next to malloc() alone.
+//     Ignored if DEBUG_MEMORY is also defined.
+//   - Neither: The macros are thin wrappers around the libc functions.
 
 #ifndef ALLOC_ALLOC_H_
 #define ALLOC_ALLOC_H_
 
 #include <stdbool.h>
 #include <stdint.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+// Where the ALLOC_*() macros get their memory from. Each function has the
+// same contract as its libc namesake.
+typedef struct {
+  const char *name;
+  void *(*calloc)(size_t count, size_t size);
+  void *(*malloc)(size_t size);
+  void *(*realloc)(void *ptr, size_t size);
+  void (*free)(void *ptr);
+} AllocBackend;
+
+// The libc allocator. Used unless alloc_init_with_backend() says otherwise.
+extern const AllocBackend ALLOC_LIBC_BACKEND;
+
 // Initializes allocation system.
 void alloc_init();
+// Initializes allocation system so that the ALLOC_*() macros use [backend].
+//
+// Details:
+//   - Must be called before anything is allocated with the ALLOC_*() macros,
+//     since blocks must be freed by the backend that allocated them.
+//   - ALLOC_ALIGNED() always uses libc.
+//   - Bookkeeping used by DEBUG_MEMORY and SAMPLE_MEMORY builds always uses
+//     libc.
+//
+// Usage:
+//   alloc_init_with_backend(&ALLOC_LIBC_BACKEND);
+void alloc_init_with_backend(const AllocBackend *backend);
 // If alloc was inited.
 // If false, it can be initted by alloc_init().
 bool alloc_ready();
 // Finalizes allocation system and frees any unfreed memory.
 void alloc_finalize();
-// Allocation will output to stdout when memory is requested.
-void alloc_set_verbose(bool);
+// Starts recording every allocation, reallocation, and deallocation to [path]
+// in a compact binary format. Returns false if the log could not be started.
+//
+// Details:
+//   - Only DEBUG_MEMORY and SAMPLE_MEMORY builds produce events. In
+//     SAMPLE_MEMORY builds, frees of unsampled blocks are logged with a size
+//     of 0.
+//   - Events are written by a background thread, so recording is cheap enough
+//     for real workloads. Use //alloc:alloc_log_decode to read the log.
+//   - The log is stopped by alloc_finalize().
+//
+// Usage:
+//   alloc_log_start("/tmp/my_program.alloc_log");
+bool alloc_log_start(const char path[]);
+// Stops recording allocation events and writes out any pending ones.
+void alloc_log_stop();
+// Where alloc_set_verbose() records allocation events.
+#define ALLOC_DEFAULT_LOG_PATH "alloc.log"
+// Starts or stops recording allocation events to ALLOC_DEFAULT_LOG_PATH.
+// Returns false if the log could not be started. See alloc_log_start().
+bool alloc_set_verbose(bool);
+// Sets the mean number of bytes allocated between samples in SAMPLE_MEMORY
+// builds. 0 samples every allocation. Defaults to 512 KiB.
+//
+// Details:
+//   - Must be called before alloc_init().
+void alloc_set_sample_interval(size_t bytes);
+// Writes a heap profile to [file]: one row per allocation site with its live
+// bytes, peak live bytes, allocation and free counts, and allocation rate,
+// sorted by live bytes and then by peak bytes.
+//
+// Details:
+//   - In SAMPLE_MEMORY builds, each sampled block stands in for the
+//     allocations around it, so counts and bytes are estimates.
+//   - Builds with neither DEBUG_MEMORY nor SAMPLE_MEMORY do not record
+//     allocations, so the profile is empty.
+//   - REALLOC*() counts as a free from the original site and an allocation at
+//     the site where REALLOC*() was called.
+//
+// Usage:
+//   alloc_profile_dump(stderr);
+void alloc_profile_dump(FILE *file);
+// Live bytes and blocks for every allocation site at one point in time.
+typedef struct __AllocSnapshot AllocSnapshot;
+// Records what is currently allocated, grouped by allocation site. Must be
+// deleted with alloc_snapshot_delete().
+//
+// Details:
+//   - Costs one read per allocation site, not per block, so it is cheap
+//     enough to take periodically in a long-running process.
+//   - In SAMPLE_MEMORY builds the counts are estimates, as in
+//     alloc_profile_dump().
+AllocSnapshot *alloc_snapshot();
+// Frees [snapshot].
+void alloc_snapshot_delete(AllocSnapshot *snapshot);
+// Writes the allocation sites whose live bytes grew between [before] and
+// [after] to [file], largest growth first, along with the total change.
+//
+// Usage:
+//   AllocSnapshot *before = alloc_snapshot();
+//   run_for_a_while();
+//   AllocSnapshot *after = alloc_snapshot();
+//   alloc_diff(before, after, stderr);
+//   alloc_snapshot_delete(before);
+//   alloc_snapshot_delete(after);
+void alloc_diff(const AllocSnapshot *before, const AllocSnapshot *after,
+                FILE *file);
+
+// Identifies a subsystem whose memory is accounted for separately.
+//
+// Each block is charged to the tag that was current on the allocating thread,
+// and stays charged to it when it is reallocated or freed, even from another
+// thread.
+//
+// Details:
+//   - Only DEBUG_MEMORY and SAMPLE_MEMORY builds keep counts, since they are
+//     the builds where blocks have a header to record their tag in.
+//   - In SAMPLE_MEMORY builds only sampled blocks have a header, so each
+//     charges its tag with the bytes it stands in for, as in
+//     alloc_profile_dump(). Counts and budgets are estimates.
+typedef uint16_t AllocTag;
+// The tag that blocks are charged to unless another is set.
+#define ALLOC_TAG_NONE 0
+// Maximum number of tags, including ALLOC_TAG_NONE.
+#define ALLOC_MAX_TAGS 256
+// Called when a tag goes over a budget. See alloc_tag_set_budget().
+typedef void (*AllocBudgetCallback)(AllocTag tag, bool hard, int64_t bytes,
+                                    size_t budget);
+
+// Returns the tag named [name], registering it if needed. Returns
+// ALLOC_TAG_NONE if ALLOC_MAX_TAGS tags are already registered.
+AllocTag alloc_tag_register(const char name[]);
+// Returns the name of [tag], or NULL if it is not registered.
+const char *alloc_tag_name(AllocTag tag);
+// Charges blocks allocated by the calling thread to [tag] from now on.
+// Returns the tag that was current, so that it can be restored.
+//
+// Usage:
+//   AllocTag prev = alloc_tag_set(parser_tag);
+//   ...
+//   alloc_tag_set(prev);
+AllocTag alloc_tag_set(AllocTag tag);
+// Returns the bytes charged to [tag] and not yet freed.
+//
+// Details:
+//   - Adds up every thread's unflushed counts, so it is exact only when no
+//     other thread is allocating under [tag].
+int64_t alloc_tag_bytes(AllocTag tag);
+// Sets budgets for [tag]. 0 means no budget.
+//
+// Details:
+//   - Going over [soft_bytes] invokes the budget callback once. It is invoked
+//     again only after the tag drops back under the budget.
+//   - Going over [hard_bytes] invokes the budget callback each time the tag
+//     grows while over it.
+//   - Each thread only adds its allocations to a tag's total every 64 KiB, so
+//     a budget may be noticed up to 64 KiB per thread late.
+void alloc_tag_set_budget(AllocTag tag, size_t soft_bytes, size_t hard_bytes);
+// Sets the function invoked when a tag goes over a budget, on the thread that
+// pushed it over. If NULL, a warning is printed to stderr instead.
+void alloc_set_budget_callback(AllocBudgetCallback callback);
 
 // Allocates a solid memory block of size: [sizeof(type)*count].
 //
@@ -33,8 +193,14 @@ void alloc_set_verbose(bool);
 #define ALLOC_ARRAY(type, count)                                        \
   (type *)__alloc(/*type=*/sizeof(type), /*count=*/(count), (__LINE__), \
                   (__func__), (__FILE__), (#type))
+#elif defined(SAMPLE_MEMORY)
+#define ALLOC_ARRAY(type, count)                                    \
+  (type *)__sampled_alloc(/*type=*/sizeof(type), /*count=*/(count), \
+                          /*clear=*/true, (__LINE__), (__func__),   \
+                          (__FILE__), (#type))
 #else
-#define ALLOC_ARRAY(type, count) (type *)calloc((count), sizeof(type))
+#define ALLOC_ARRAY(type, count) \
+  (type *)__alloc_backend->calloc((count), sizeof(type))
 #endif
 
 // Allocates a solid memory block of size: [sizeof(type)*count].
@@ -51,8 +217,14 @@ void alloc_set_verbose(bool);
 #define ALLOC_ARRAY2(type, count)                                       \
   (type *)__alloc(/*type=*/sizeof(type), /*count=*/(count), (__LINE__), \
                   (__func__), (__FILE__), (#type))
+#elif defined(SAMPLE_MEMORY)
+#define ALLOC_ARRAY2(type, count)                                   \
+  (type *)__sampled_alloc(/*type=*/sizeof(type), /*count=*/(count), \
+                          /*clear=*/false, (__LINE__), (__func__),  \
+                          (__FILE__), (#type))
 #else
-#define ALLOC_ARRAY2(type, count) (type *)malloc((count) * sizeof(type))
+#define ALLOC_ARRAY2(type, count) \
+  (type *)__alloc_backend->malloc((count) * sizeof(type))
 #endif
 
 // Allocates a solid memory block of size: [type_sz*count].
@@ -69,8 +241,13 @@ void alloc_set_verbose(bool);
 #define ALLOC_ARRAY_SZ(type_name, type_sz, count)                        \
   __alloc(/*type=*/(type_sz), /*count=*/(count), (__LINE__), (__func__), \
           (__FILE__), (type_name))
+#elif defined(SAMPLE_MEMORY)
+#define ALLOC_ARRAY_SZ(type_name, type_sz, count)                         \
+  __sampled_alloc(/*type=*/(type_sz), /*count=*/(count), /*clear=*/false, \
+                  (__LINE__), (__func__), (__FILE__), (type_name))
 #else
-#define ALLOC_ARRAY_SZ(type_name, type_sz, count) malloc((count) * (type_sz))
+#define ALLOC_ARRAY_SZ(type_name, type_sz, count) \
+  __alloc_backend->malloc((count) * (type_sz))
 #endif
 
 // Allocates a new solid memory block of size: [type_sz*count] and
@@ -87,9 +264,14 @@ void alloc_set_verbose(bool);
 #define REALLOC_SZ(ptr, type_sz, count)                                   \
   (void *)__realloc(/*ptr=*/(ptr), /*type=*/(type_sz), /*count=*/(count), \
                     (__LINE__), (__func__), (__FILE__))
+#elif defined(SAMPLE_MEMORY)
+#define REALLOC_SZ(ptr, type_sz, count)                                \
+  (void *)__sampled_realloc(/*ptr=*/(ptr), /*type=*/(type_sz),         \
+                            /*count=*/(count), (__LINE__), (__func__), \
+                            (__FILE__))
 #else
 #define REALLOC_SZ(ptr, type_sz, count) \
-  (void *)realloc((ptr), (type_sz) * (count))
+  (void *)__alloc_backend->realloc((ptr), (type_sz) * (count))
 #endif
 
 // Allocates a new solid memory block of size: [sizeof(type)*count] and
@@ -102,11 +284,12 @@ void alloc_set_verbose(bool);
 // Usage:
 //   MyStruct *arr = ALLOC_ARRAY2(MyStruct, 20);
 //   arr = REALLOC(arr, MyStruct, 50);
-#ifdef DEBUG_MEMORY
+#if defined(DEBUG_MEMORY) || defined(SAMPLE_MEMORY)
 #define REALLOC(ptr, type, count) \
   (type *)REALLOC_SZ((ptr), sizeof(type), (count))
 #else
-#define REALLOC(ptr, type, count) (type *)realloc((ptr), sizeof(type) * (count))
+#define REALLOC(ptr, type, count) \
+  (type *)__alloc_backend->realloc((ptr), sizeof(type) * (count))
 #endif
 
 // Frees a new solid memory block located at [ptr].
@@ -121,8 +304,171 @@ void alloc_set_verbose(bool);
 #ifdef DEBUG_MEMORY
 #define DEALLOC(ptr) \
   __dealloc((void **)&(ptr), (__LINE__), (__func__), (__FILE__))
+#elif defined(SAMPLE_MEMORY)
+#define DEALLOC(ptr) __sampled_dealloc((void *)(ptr))
+#else
+#define DEALLOC(ptr) __alloc_backend->free((void *)(ptr))
+#endif
+
+// Allocates a solid memory block of size: [sizeof(type)*count] whose address
+// is a multiple of [align].
+//
+// Details:
+//   - This function always clears memory.
+//   - [align] must be a power of 2. Use 64 to keep a structure on its own
+//     cache lines, or 32 for aligned AVX loads.
+//   - The block must be freed with DEALLOC_ALIGNED() and cannot be passed to
+//     REALLOC*().
+//   - Without DEBUG_MEMORY or SAMPLE_MEMORY, returns NULL if [align] is not a
+//     power of 2.
+//   - Can only bee used after alloc_init() has been called.
+//
+// Usage:
+//   MyStruct *arr = ALLOC_ALIGNED(MyStruct, 20, 64);
+//   DEALLOC_ALIGNED(arr);
+#ifdef DEBUG_MEMORY
+#define ALLOC_ALIGNED(type, count, align)                                    \
+  (type *)__alloc_aligned(/*type=*/sizeof(type), /*count=*/(count), (align), \
+                          (__LINE__), (__func__), (__FILE__), (#type))
+#elif defined(SAMPLE_MEMORY)
+#define ALLOC_ALIGNED(type, count, align)                                   \
+  (type *)__sampled_alloc_aligned(/*type=*/sizeof(type), /*count=*/(count), \
+                                  (align), (__LINE__), (__func__),          \
+                                  (__FILE__), (#type))
+#else
+#define ALLOC_ALIGNED(type, count, align) \
+  (type *)__aligned_calloc((align), (count) * sizeof(type))
+#endif
+
+// Frees a memory block located at [ptr] that was allocated by
+// ALLOC_ALIGNED().
+//
+// Usage:
+//   MyStruct *arr = ALLOC_ALIGNED(MyStruct, 20, 64);
+//   DEALLOC_ALIGNED(arr);
+#ifdef DEBUG_MEMORY
+#define DEALLOC_ALIGNED(ptr) DEALLOC(ptr)
+#elif defined(SAMPLE_MEMORY)
+#define DEALLOC_ALIGNED(ptr) __sampled_dealloc_aligned((void *)(ptr))
+#else
+#define DEALLOC_ALIGNED(ptr) free((void *)(ptr))
+#endif
+
+// Allocates a solid memory block of size: [sizeof(type)*count] in its own
+// memory mapping, for big buffers that are expected to grow.
+//
+// Details:
+//   - This function always clears memory, using zero pages from the kernel
+//     rather than memset().
+//   - Each block takes whole pages, so this is only worthwhile for blocks of
+//     at least a few hundred KiB.
+//   - The block must be resized with REALLOC_LARGE() and freed with
+//     DEALLOC_LARGE().
+//   - Does not use the AllocBackend.
+//   - Without DEBUG_MEMORY or SAMPLE_MEMORY, returns NULL on failure.
+//   - Can only bee used after alloc_init() has been called.
+//
+// Usage:
+//   char *buf = ALLOC_ARRAY_LARGE(char, 1 << 20);
+#ifdef DEBUG_MEMORY
+#define ALLOC_ARRAY_LARGE(type, count)                                      \
+  (type *)__alloc_large(/*type=*/sizeof(type), /*count=*/(count),           \
+                        /*huge=*/false, (__LINE__), (__func__), (__FILE__), \
+                        (#type))
+#elif defined(SAMPLE_MEMORY)
+#define ALLOC_ARRAY_LARGE(type, count)                                    \
+  (type *)__sampled_alloc_large(/*type=*/sizeof(type), /*count=*/(count), \
+                                /*huge=*/false, (__LINE__), (__func__),   \
+                                (__FILE__), (#type))
+#else
+#define ALLOC_ARRAY_LARGE(type, count) \
+  (type *)__large_alloc((count) * sizeof(type), /*huge=*/false)
+#endif
+
+// Like ALLOC_ARRAY_LARGE(), but asks for the block to be backed by 2 MiB
+// transparent huge pages, which cuts TLB misses on big lookup tables.
+//
+// Details:
+//   - The mapping is 2 MiB-aligned and a multiple of 2 MiB, and is advised
+//     with MADV_HUGEPAGE.
+//   - If transparent huge pages are unavailable, the block is still usable
+//     but uses normal pages. See alloc_huge_stats().
+//   - The block must be resized with REALLOC_LARGE() and freed with
+//     DEALLOC_LARGE().
+//
+// Usage:
+//   uint64_t *table = ALLOC_ARRAY_HUGE(uint64_t, 1 << 24);
+#ifdef DEBUG_MEMORY
+#define ALLOC_ARRAY_HUGE(type, count)                                      \
+  (type *)__alloc_large(/*type=*/sizeof(type), /*count=*/(count),          \
+                        /*huge=*/true, (__LINE__), (__func__), (__FILE__), \
+                        (#type))
+#elif defined(SAMPLE_MEMORY)
+#define ALLOC_ARRAY_HUGE(type, count)                                     \
+  (type *)__sampled_alloc_large(/*type=*/sizeof(type), /*count=*/(count), \
+                                /*huge=*/true, (__LINE__), (__func__),    \
+                                (__FILE__), (#type))
+#else
+#define ALLOC_ARRAY_HUGE(type, count) \
+  (type *)__large_alloc((count) * sizeof(type), /*huge=*/true)
+#endif
+
+// How much of the memory allocated by ALLOC_ARRAY_HUGE() is on huge pages.
+typedef struct {
+  // Bytes currently mapped for ALLOC_ARRAY_HUGE() blocks.
+  size_t mapped_bytes;
+  // Of mapped_bytes, how many the kernel accepted MADV_HUGEPAGE for.
+  size_t advised_bytes;
+  // Of mapped_bytes, how many are actually backed by huge pages, per
+  // /proc/self/smaps. 0 if it cannot be read.
+  size_t huge_page_bytes;
+} AllocHugeStats;
+
+// Returns counters for ALLOC_ARRAY_HUGE() blocks.
+//
+// Details:
+//   - Reads /proc/self/smaps, so is not meant to be called often.
+AllocHugeStats alloc_huge_stats();
+
+// Resizes a block allocated by ALLOC_ARRAY_LARGE() to [sizeof(type)*count].
+//
+// Details:
+//   - The block's pages are remapped with mremap() rather than copied, so
+//     this takes about the same time regardless of the size of the block.
+//   - Any new elements are cleared.
+//   - Without DEBUG_MEMORY or SAMPLE_MEMORY, returns NULL on failure and
+//     leaves the block as it was.
+//
+// Usage:
+//   char *buf = ALLOC_ARRAY_LARGE(char, 1 << 20);
+//   buf = REALLOC_LARGE(buf, char, 1 << 30);
+#ifdef DEBUG_MEMORY
+#define REALLOC_LARGE(ptr, type, count)                         \
+  (type *)__realloc_large(/*ptr=*/(ptr), /*type=*/sizeof(type), \
+                          /*count=*/(count), (__LINE__), (__func__), (__FILE__))
+#elif defined(SAMPLE_MEMORY)
+#define REALLOC_LARGE(ptr, type, count)                                      \
+  (type *)__sampled_realloc_large(/*ptr=*/(ptr), /*type=*/sizeof(type),      \
+                                  /*count=*/(count), (__LINE__), (__func__), \
+                                  (__FILE__))
 #else
-#define DEALLOC(ptr) free((void *)(ptr))
+#define REALLOC_LARGE(ptr, type, count) \
+  (type *)__large_realloc((ptr), (count) * sizeof(type))
+#endif
+
+// Frees a memory block located at [ptr] that was allocated by
+// ALLOC_ARRAY_LARGE().
+//
+// Usage:
+//   char *buf = ALLOC_ARRAY_LARGE(char, 1 << 20);
+//   DEALLOC_LARGE(buf);
+#ifdef DEBUG_MEMORY
+#define DEALLOC_LARGE(ptr) \
+  __dealloc_large((void **)&(ptr), (__LINE__), (__func__), (__FILE__))
+#elif defined(SAMPLE_MEMORY)
+#define DEALLOC_LARGE(ptr) __sampled_dealloc_large((void *)(ptr))
+#else
+#define DEALLOC_LARGE(ptr) __large_free((void *)(ptr))
 #endif
 
 // Allocates a solid memory block of size: [sizeof(type)].
@@ -160,8 +506,12 @@ void alloc_set_verbose(bool);
 #ifdef DEBUG_MEMORY
 #define ALLOC_STRDUP(str) \
   __strndup((char *)str, strlen(str), (__LINE__), (__func__), (__FILE__))
+#elif defined(SAMPLE_MEMORY)
+#define ALLOC_STRDUP(str)                                             \
+  __sampled_strndup((char *)str, strlen(str), (__LINE__), (__func__), \
+                    (__FILE__))
 #else
-#define ALLOC_STRDUP(str) strndup((char *)(str), strlen(str))
+#define ALLOC_STRDUP(str) __backend_strndup((char *)(str), strlen(str))
 #endif
 
 // Source: https://linux.die.net/man/3/strndup
@@ -183,8 +533,11 @@ void alloc_set_verbose(bool);
 #ifdef DEBUG_MEMORY
 #define ALLOC_STRNDUP(str, len) \
   __strndup((char *)str, len, (__LINE__), (__func__), (__FILE__))
+#elif defined(SAMPLE_MEMORY)
+#define ALLOC_STRNDUP(str, len) \
+  __sampled_strndup((char *)str, len, (__LINE__), (__func__), (__FILE__))
 #else
-#define ALLOC_STRNDUP(str, len) strndup((char *)(str), len)
+#define ALLOC_STRNDUP(str, len) __backend_strndup((char *)(str), len)
 #endif
 
 // Functions that are wrapped by the macros and should not be called directly.
@@ -194,11 +547,48 @@ void *__alloc(uint32_t elt_size, uint32_t count, uint32_t line,
 void *__realloc(void *, uint32_t elt_size, uint32_t count, uint32_t line,
                 const char func[], const char file[]);
 void __dealloc(void **, uint32_t line, const char func[], const char file[]);
+void *__alloc_aligned(uint32_t elt_size, uint32_t count, size_t align,
+                      uint32_t line, const char func[], const char file[],
+                      const char type_name[]);
+void *__alloc_large(uint32_t elt_size, uint32_t count, bool huge,
+                    uint32_t line, const char func[], const char file[],
+                    const char type_name[]);
+void *__realloc_large(void *, uint32_t elt_size, uint32_t count,
+                      uint32_t line, const char func[], const char file[]);
+void __dealloc_large(void **, uint32_t line, const char func[],
+                     const char file[]);
 char *__strndup(char *, size_t len, uint32_t line, const char func[],
                 const char file[]);
 
+#elif defined(SAMPLE_MEMORY)
+void *__sampled_alloc(uint32_t elt_size, uint32_t count, bool clear,
+                      uint32_t line, const char func[], const char file[],
+                      const char type_name[]);
+void *__sampled_realloc(void *, uint32_t elt_size, uint32_t count,
+                        uint32_t line, const char func[], const char file[]);
+void __sampled_dealloc(void *);
+void *__sampled_alloc_aligned(uint32_t elt_size, uint32_t count, size_t align,
+                              uint32_t line, const char func[],
+                              const char file[], const char type_name[]);
+void __sampled_dealloc_aligned(void *);
+void *__sampled_alloc_large(uint32_t elt_size, uint32_t count, bool huge,
+                            uint32_t line, const char func[],
+                            const char file[], const char type_name[]);
+void *__sampled_realloc_large(void *, uint32_t elt_size, uint32_t count,
+                              uint32_t line, const char func[],
+                              const char file[]);
+void __sampled_dealloc_large(void *);
+char *__sampled_strndup(char *, size_t len, uint32_t line, const char func[],
+                        const char file[]);
+
 #elif !defined(STRNDUP_AVAILABLE)
 char *strndup(const char *s, size_t n);
 #endif
+void *__aligned_calloc(size_t align, size_t size);
+char *__backend_strndup(const char *str, size_t len);
+void *__large_alloc(size_t size, bool huge);
+void *__large_realloc(void *, size_t size);
+void __large_free(void *);
+extern const AllocBackend *__alloc_backend;
 
 #endif /* ALLOC_ALLOC_H_ */
@@ -0,0 +1,136 @@
+// alloc_log_decode.c
+//
+// Created on: Oct 17, 2026
+//     Author: Jeff Manzione
+//
+// Prints a log recorded by alloc_log_start() in a readable form.
+//
+// Usage:
+//   alloc_log_decode <log_file>
+
+#include <stdio.h>
+#include <string.h>
+
+#include "alloc/alloc.h"
+#include "alloc/event_log.h"
+
+typedef struct {
+  uint32_t line;
+  char *strings;
+  const char *type_name, *func, *file;
+} _Site;
+
+typedef struct {
+  _Site *sites;
+  uint32_t num_sites;
+} _Sites;
+
+void _sites_add(_Sites *sites, uint32_t site_id, uint32_t line,
+                char *strings) {
+  if (site_id > sites->num_sites) {
+    sites->sites = (NULL == sites->sites)
+                       ? ALLOC_ARRAY2(_Site, site_id)
+                       : REALLOC(sites->sites, _Site, site_id);
+    memset(sites->sites + sites->num_sites, 0,
+           sizeof(_Site) * (site_id - sites->num_sites));
+    sites->num_sites = site_id;
+  }
+  _Site *site = &sites->sites[site_id - 1];
+  site->line = line;
+  site->strings = strings;
+  site->type_name = strings;
+  site->func = site->type_name + strlen(site->type_name) + 1;
+  site->file = site->func + strlen(site->func) + 1;
+}
+
+const _Site *_sites_lookup(const _Sites *sites, uint32_t site_id) {
+  if (0 == site_id || site_id > sites->num_sites ||
+      NULL == sites->sites[site_id - 1].strings) {
+    return NULL;
+  }
+  return &sites->sites[site_id - 1];
+}
+
+void _print_event(const AllocEvent *event, const _Sites *sites) {
+  printf("%.9f\tthread %u\t", event->timestamp / 1e9, event->thread_id);
+  switch (event->op) {
+    case ALLOC_EVENT_ALLOC:
+      printf("Allocated %lu bytes at %p", (unsigned long)event->size,
+             (void *)(uintptr_t)event->ptr);
+      break;
+    case ALLOC_EVENT_REALLOC:
+      printf("Reallocated memory from %p to %p with %lu bytes",
+             (void *)(uintptr_t)event->old_ptr, (void *)(uintptr_t)event->ptr,
+             (unsigned long)event->size);
+      break;
+    case ALLOC_EVENT_DEALLOC:
+      printf("Deallocated %lu bytes from %p", (unsigned long)event->size,
+             (void *)(uintptr_t)event->ptr);
+      break;
+    default:
+      printf("Unknown event %d", event->op);
+      break;
+  }
+  const _Site *site = _sites_lookup(sites, event->site_id);
+  if (NULL != site) {
+    printf("\t%s[] from %s:%d in %s(...)", site->type_name, site->file,
+           site->line, site->func);
+  }
+  printf("\n");
+}
+
+int main(int argc, const char *argv[]) {
+  if (argc != 2) {
+    fprintf(stderr, "Usage: %s <log_file>\n", argv[0]);
+    return 1;
+  }
+  FILE *file = fopen(argv[1], "rb");
+  if (NULL == file) {
+    fprintf(stderr, "Could not open '%s'.\n", argv[1]);
+    return 1;
+  }
+  char magic[ALLOC_EVENT_LOG_MAGIC_SZ];
+  if (ALLOC_EVENT_LOG_MAGIC_SZ !=
+          fread(magic, 1, ALLOC_EVENT_LOG_MAGIC_SZ, file) ||
+      0 != memcmp(magic, ALLOC_EVENT_LOG_MAGIC, ALLOC_EVENT_LOG_MAGIC_SZ)) {
+    fprintf(stderr, "'%s' is not an allocation log.\n", argv[1]);
+    fclose(file);
+    return 1;
+  }
+  alloc_init();
+  _Sites sites = {.sites = NULL, .num_sites = 0};
+  uint64_t num_events = 0, num_dropped = 0;
+  AllocEvent event;
+  while (1 == fread(&event, sizeof(AllocEvent), 1, file)) {
+    if (ALLOC_EVENT_SITE == event.op) {
+      char *strings = ALLOC_ARRAY2(char, event.size);
+      if (event.size != fread(strings, 1, event.size, file)) {
+        DEALLOC(strings);
+        break;
+      }
+      _sites_add(&sites, event.site_id, (uint32_t)event.ptr, strings);
+      continue;
+    }
+    if (ALLOC_EVENT_DROPPED == event.op) {
+      printf("%.9f\tDropped %lu events.\n", event.timestamp / 1e9,
+             (unsigned long)event.size);
+      num_dropped += event.size;
+      continue;
+    }
+    _print_event(&event, &sites);
+    num_events++;
+  }
+  fclose(file);
+  fprintf(stderr, "%lu events, %lu dropped.\n", (unsigned long)num_events,
+          (unsigned long)num_dropped);
+  for (uint32_t i = 0; i < sites.num_sites; ++i) {
+    if (NULL != sites.sites[i].strings) {
+      DEALLOC(sites.sites[i].strings);
+    }
+  }
+  if (NULL != sites.sites) {
+    DEALLOC(sites.sites);
+  }
+  alloc_finalize();
+  return 0;
+}
@@ -5,10 +5,13 @@
 
 #include "alloc/arena/arena.h"
 
-#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "alloc/alloc.h"
+#include "alloc/arena/subarena.h"
 #include "debug/debug.h"
 
 #define DEFAULT_ELTS_IN_CHUNK 128
@@ -16,74 +19,489 @@
 // Treates a void* as a char* to make Windows CC happy.
 #define _CHAR_POINTER(void_ptr) ((char *)(void_ptr))
 
-int descriptor_sz;
+// Freed slots hold a pointer to the previously freed slot, so every slot must
+// be able to hold one. Slots are only aligned for their type, so the pointer is
+// copied in and out rather than dereferenced.
+#define MIN_SLOT_SZ sizeof(void *)
 
-typedef struct {
-  void *prev_freed;
-} Descriptor;
-
-struct __Subarena {
-  _Subarena *prev;
-  void *block;
-  size_t block_sz;
-};
-
-_Subarena *_subarena_create(_Subarena *prev, size_t sz) {
-  _Subarena *sa = ALLOC2(_Subarena);
-  sa->block_sz = sz * DEFAULT_ELTS_IN_CHUNK;
-  sa->block = malloc(sa->block_sz);
-  sa->prev = prev;
+static inline void *_next_free(void *slot) {
+  void *next;
+  memcpy(&next, slot, sizeof(void *));
+  return next;
+}
+
+static inline void _set_next_free(void *slot, void *next) {
+  memcpy(slot, &next, sizeof(void *));
+}
+
+_Subarena *_arena_subarena_create(__Arena *arena, size_t elts) {
+  _Subarena *sa = NULL;
+  if (NULL != arena->reservation) {
+    sa = _subarena_create_reserved(arena->reservation, arena->alloc_sz * elts,
+                                   arena->align);
+  }
+  if (NULL == sa) {
+    sa = _subarena_create(arena->alloc_sz * elts, arena->align);
+  }
+  ++arena->num_subarenas;
+  arena->subarena_bytes += sa->block_sz;
   return sa;
 }
 
-void _subarena_delete(_Subarena *sa) {
-  if (NULL != sa->prev) {
-    _subarena_delete(sa->prev);
+static inline size_t _subarena_elts(const __Arena *arena, const _Subarena *sa) {
+  return sa->block_sz / arena->alloc_sz;
+}
+
+// Returns how many blocks have been carved from the subarenas so far.
+static inline size_t _arena_carved(const __Arena *arena) {
+  return arena->carved_before_current +
+         (_CHAR_POINTER(arena->next) - _CHAR_POINTER(arena->current->block)) /
+             arena->alloc_sz;
+}
+
+// Records the high-water mark before blocks are un-carved by a reset,
+// rollback or trim.
+static inline void _arena_update_high_water(__Arena *arena) {
+  size_t carved = _arena_carved(arena);
+  if (carved > arena->high_water_blocks) {
+    arena->high_water_blocks = carved;
   }
-  free(sa->block);
-  DEALLOC(sa);
+}
+
+void _arena_use_subarena(__Arena *arena, _Subarena *sa) {
+  arena->current = sa;
+  arena->next = sa->block;
+  arena->end = _CHAR_POINTER(sa->block) + sa->block_sz;
+}
+
+// Returns how many elements the subarena after the last one should hold.
+size_t _next_subarena_elts(const __Arena *arena) {
+  const ArenaOptions *opts = &arena->opts;
+  if (opts->growth_factor <= 1) {
+    return arena->last_elts;
+  }
+  size_t elts = arena->last_elts * opts->growth_factor;
+  if (elts / opts->growth_factor != arena->last_elts ||
+      (0 != opts->max_elts && elts > opts->max_elts)) {
+    elts = 0 != opts->max_elts ? opts->max_elts : arena->last_elts;
+  }
+  return elts;
 }
 
 void __arena_init(__Arena *arena, size_t sz, const char name[]) {
-  ASSERT_NOT_NULL(arena);
-  descriptor_sz = ((int)ceil(((float)sizeof(Descriptor)) / 4)) * 4;
+  // A type's alignment divides its size, and only over-aligned types need more
+  // than max_align_t.
+  size_t align = sz & -sz;
+  if (align > _Alignof(max_align_t)) {
+    align = _Alignof(max_align_t);
+  }
+  const ArenaOptions opts = {.initial_elts = DEFAULT_ELTS_IN_CHUNK};
+  __arena_init_with(arena, sz, align, name, opts);
+}
+
+void __arena_init_with(__Arena *arena, size_t sz, size_t align,
+                       const char name[], ArenaOptions opts) {
+  ASSERT(NOT_NULL(arena), 0 == (align & (align - 1)));
   arena->name = name;
-  arena->alloc_sz = sz + descriptor_sz;
-  arena->last = _subarena_create(NULL, arena->alloc_sz);
-  arena->next = arena->last->block;
-  arena->end = _CHAR_POINTER(arena->last->block) + arena->last->block_sz;
+  arena->align = align;
+  // A type's size is a multiple of its alignment, so slots are only padded if
+  // they are too small to hold the free list link.
+  if (sz < MIN_SLOT_SZ) {
+    sz = MIN_SLOT_SZ;
+  }
+  arena->alloc_sz = (sz + align - 1) & ~(align - 1);
+  arena->opts = opts;
+  arena->last_elts =
+      0 == opts.initial_elts ? DEFAULT_ELTS_IN_CHUNK : opts.initial_elts;
+  if (0 != opts.max_elts && arena->last_elts > opts.max_elts) {
+    arena->last_elts = opts.max_elts;
+  }
+  arena->checkpoints = 0;
+  arena->generation = 0;
+  arena->num_subarenas = arena->subarena_bytes = 0;
+  arena->carved_before_current = 0;
+  arena->free_blocks = 0;
+  arena->high_water_blocks = 0;
+  arena->reservation = NULL;
+  if (0 != opts.reserve_bytes) {
+    arena->reservation = ALLOC2(_Reservation);
+    _reservation_init(arena->reservation, opts.reserve_bytes);
+  }
+  arena->first = arena->last = _arena_subarena_create(arena, arena->last_elts);
+  _arena_use_subarena(arena, arena->first);
   arena->last_freed = NULL;
 }
 
 void __arena_finalize(__Arena *arena) {
   ASSERT_NOT_NULL(arena);
-  _subarena_delete(arena->last);
+  _subarena_delete_all(arena->first);
+  if (NULL != arena->reservation) {
+    _reservation_release(arena->reservation);
+    DEALLOC(arena->reservation);
+  }
+}
+
+void __arena_reset(__Arena *arena) {
+  ASSERT_NOT_NULL(arena);
+  _arena_update_high_water(arena);
+  if (0 != arena->opts.retain_elts) {
+    // Keep subarenas from the front while they fit, but always the first.
+    _Subarena *keep = arena->first;
+    size_t kept_elts = keep->block_sz / arena->alloc_sz;
+    while (NULL != keep->next) {
+      size_t elts = keep->next->block_sz / arena->alloc_sz;
+      if (kept_elts + elts > arena->opts.retain_elts) {
+        break;
+      }
+      kept_elts += elts;
+      keep = keep->next;
+    }
+    if (NULL != arena->reservation) {
+      // Addresses in the reservation cannot be handed back out, so the rest
+      // are kept without their memory instead.
+      for (_Subarena *sa = keep->next; NULL != sa; sa = sa->next) {
+        _subarena_decommit(sa);
+      }
+    } else {
+      for (_Subarena *sa = keep->next; NULL != sa; sa = sa->next) {
+        --arena->num_subarenas;
+        arena->subarena_bytes -= sa->block_sz;
+      }
+      _subarena_delete_all(keep->next);
+      keep->next = NULL;
+      arena->last = keep;
+      // Growth picks up from the last subarena kept.
+      arena->last_elts = keep->block_sz / arena->alloc_sz;
+    }
+  }
+  _arena_use_subarena(arena, arena->first);
+  arena->last_freed = NULL;
+  arena->checkpoints = 0;
+  ++arena->generation;
+  arena->carved_before_current = 0;
+  arena->free_blocks = 0;
+}
+
+// Moves on to the subarena after the current one, which must hold at least
+// [min_elts] elements. Reuses the one a reset left behind if it is large
+// enough, and otherwise inserts a new one.
+void _arena_advance(__Arena *arena, size_t min_elts) {
+  _Subarena *sa = arena->current->next;
+  if (NULL == sa || sa->block_sz / arena->alloc_sz < min_elts) {
+    if (NULL == sa) {
+      arena->last_elts = _next_subarena_elts(arena);
+    }
+    size_t elts = arena->last_elts > min_elts ? arena->last_elts : min_elts;
+    sa = _arena_subarena_create(arena, elts);
+    sa->next = arena->current->next;
+    arena->current->next = sa;
+    if (arena->last == arena->current) {
+      arena->last = sa;
+    }
+  }
+  arena->carved_before_current += _subarena_elts(arena, arena->current);
+  _arena_use_subarena(arena, sa);
+}
+
+// Which blocks of a subarena are in use, worked out from the free list since
+// the arena does not track them as it goes.
+typedef struct {
+  _Subarena *sa;
+  // Blocks that have been handed out, and how many of those are free.
+  size_t used_elts, free_elts;
+  // Where the subarena's blocks start in the free bitmap, if there is one.
+  size_t first_bit;
+} _SubarenaUse;
+
+static int _subarena_use_compare(const void *a, const void *b) {
+  const char *block_a = ((const _SubarenaUse *)a)->sa->block;
+  const char *block_b = ((const _SubarenaUse *)b)->sa->block;
+  return block_a < block_b ? -1 : block_a > block_b ? 1 : 0;
+}
+
+// Returns the entry in [uses], sorted by block, for the subarena holding [ptr].
+static _SubarenaUse *_subarena_use_find(_SubarenaUse *uses, size_t num_uses,
+                                        const void *ptr) {
+  size_t lo = 0, hi = num_uses;
+  while (hi - lo > 1) {
+    size_t mid = lo + (hi - lo) / 2;
+    if ((const char *)uses[mid].sa->block <= (const char *)ptr) {
+      lo = mid;
+    } else {
+      hi = mid;
+    }
+  }
+  return &uses[lo];
+}
+
+static inline bool _subarena_use_is_free(const _SubarenaUse *use) {
+  return use->free_elts == use->used_elts;
+}
+
+// Returns a _SubarenaUse for each of [arena]'s subarenas, sorted by block. If
+// [free_bits] is not NULL, it is set to a bitmap with a bit set for each free
+// block, which must be freed with DEALLOC() along with the returned array.
+static _SubarenaUse *_arena_uses(const __Arena *arena, size_t *num_uses,
+                                 uint64_t **free_bits) {
+  *num_uses = 0;
+  for (_Subarena *sa = arena->first; NULL != sa; sa = sa->next) {
+    ++*num_uses;
+  }
+  _SubarenaUse *uses = ALLOC_ARRAY2(_SubarenaUse, *num_uses);
+  bool past_current = false;
+  size_t i = 0;
+  for (_Subarena *sa = arena->first; NULL != sa; sa = sa->next, ++i) {
+    uses[i].sa = sa;
+    uses[i].free_elts = 0;
+    if (past_current) {
+      uses[i].used_elts = 0;
+    } else if (sa == arena->current) {
+      uses[i].used_elts =
+          (_CHAR_POINTER(arena->next) - _CHAR_POINTER(sa->block)) /
+          arena->alloc_sz;
+      past_current = true;
+    } else {
+      uses[i].used_elts = sa->block_sz / arena->alloc_sz;
+    }
+  }
+  qsort(uses, *num_uses, sizeof(_SubarenaUse), _subarena_use_compare);
+  size_t num_bits = 0;
+  for (i = 0; i < *num_uses; ++i) {
+    uses[i].first_bit = num_bits;
+    num_bits += uses[i].used_elts;
+  }
+  if (NULL != free_bits) {
+    *free_bits = ALLOC_ARRAY(uint64_t, num_bits / 64 + 1);
+  }
+  for (void *slot = arena->last_freed; NULL != slot; slot = _next_free(slot)) {
+    _SubarenaUse *use = _subarena_use_find(uses, *num_uses, slot);
+    ++use->free_elts;
+    if (NULL != free_bits) {
+      size_t bit = use->first_bit +
+                   (_CHAR_POINTER(slot) - _CHAR_POINTER(use->sa->block)) /
+                       arena->alloc_sz;
+      (*free_bits)[bit / 64] |= (uint64_t)1 << (bit % 64);
+    }
+  }
+  return uses;
+}
+
+void __arena_trim(__Arena *arena) {
+  ASSERT_NOT_NULL(arena);
+  _arena_update_high_water(arena);
+  // Moving subarenas and rebuilding the free list invalidate checkpoints.
+  arena->checkpoints = 0;
+  ++arena->generation;
+  size_t num_uses;
+  _SubarenaUse *uses = _arena_uses(arena, &num_uses, /*free_bits=*/NULL);
+
+  // Rebuild the free list without the blocks in subarenas being given back.
+  void *free_head = NULL, *free_tail = NULL;
+  arena->free_blocks = 0;
+  for (void *slot = arena->last_freed; NULL != slot; slot = _next_free(slot)) {
+    if (_subarena_use_is_free(_subarena_use_find(uses, num_uses, slot))) {
+      continue;
+    }
+    ++arena->free_blocks;
+    if (NULL == free_tail) {
+      free_head = slot;
+    } else {
+      _set_next_free(free_tail, slot);
+    }
+    free_tail = slot;
+  }
+  if (NULL != free_tail) {
+    _set_next_free(free_tail, NULL);
+  }
+  arena->last_freed = free_head;
+
+  // Give back the free subarenas and move the ones before the current one to
+  // right after it, so they are the next to be allocated from.
+  _Subarena *before = NULL, **before_tail = &before;
+  _Subarena *reuse = NULL, **reuse_tail = &reuse;
+  _Subarena *sa = arena->first;
+  while (sa != arena->current) {
+    _Subarena *next = sa->next;
+    if (_subarena_use_is_free(_subarena_use_find(uses, num_uses, sa->block))) {
+      _subarena_decommit(sa);
+      *reuse_tail = sa;
+      reuse_tail = &sa->next;
+    } else {
+      *before_tail = sa;
+      before_tail = &sa->next;
+    }
+    sa = next;
+  }
+  if (_subarena_use_is_free(_subarena_use_find(uses, num_uses, sa->block))) {
+    _subarena_decommit(sa);
+    _arena_use_subarena(arena, sa);
+  }
+  for (_Subarena *after = sa->next; NULL != after; after = after->next) {
+    _subarena_decommit(after);
+  }
+  *reuse_tail = sa->next;
+  sa->next = reuse;
+  *before_tail = sa;
+  arena->first = before;
+  arena->last = sa;
+  while (NULL != arena->last->next) {
+    arena->last = arena->last->next;
+  }
+  arena->carved_before_current = 0;
+  for (sa = arena->first; sa != arena->current; sa = sa->next) {
+    arena->carved_before_current += _subarena_elts(arena, sa);
+  }
+  DEALLOC(uses);
+}
+
+void __arena_for_each(__Arena *arena, ArenaAction fn) {
+  ASSERT(NOT_NULL(arena), NOT_NULL(fn));
+  size_t num_uses;
+  uint64_t *free_bits;
+  _SubarenaUse *uses = _arena_uses(arena, &num_uses, &free_bits);
+  for (size_t i = 0; i < num_uses; ++i) {
+    const _SubarenaUse *use = &uses[i];
+    for (size_t j = 0; j < use->used_elts; ++j) {
+      size_t bit = use->first_bit + j;
+      if (0 == (free_bits[bit / 64] & ((uint64_t)1 << (bit % 64)))) {
+        fn(_CHAR_POINTER(use->sa->block) + j * arena->alloc_sz);
+      }
+    }
+  }
+  DEALLOC(free_bits);
+  DEALLOC(uses);
+}
+
+void __arena_finalize_with(__Arena *arena, ArenaAction destructor) {
+  __arena_for_each(arena, destructor);
+  __arena_finalize(arena);
+}
+
+ArenaCheckpoint __arena_checkpoint(__Arena *arena) {
+  ASSERT_NOT_NULL(arena);
+  ArenaCheckpoint cp = {.current = arena->current,
+                        .next = arena->next,
+                        .last_freed = arena->last_freed,
+                        .carved_before_current = arena->carved_before_current,
+                        .free_blocks = arena->free_blocks,
+                        .generation = arena->generation};
+  ++arena->checkpoints;
+  return cp;
+}
+
+// Returns true if [cp] has not been ended by a reset or trim.
+static bool _arena_checkpoint_live(const __Arena *arena, ArenaCheckpoint cp) {
+  return cp.generation == arena->generation && arena->checkpoints > 0;
+}
+
+// Returns true if [ptr] was allocated after [cp] was taken.
+static bool _arena_allocated_since(const __Arena *arena, ArenaCheckpoint cp,
+                                   const void *ptr) {
+  const char *block = (const char *)ptr;
+  if (block >= (const char *)cp.next &&
+      block < _CHAR_POINTER(cp.current->block) + cp.current->block_sz) {
+    return true;
+  }
+  for (_Subarena *sa = cp.current; sa != arena->current;) {
+    sa = sa->next;
+    if (block >= (const char *)sa->block &&
+        block < _CHAR_POINTER(sa->block) + sa->block_sz) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void __arena_rollback(__Arena *arena, ArenaCheckpoint cp) {
+  ASSERT(NOT_NULL(arena), NOT_NULL(cp.current));
+  if (!_arena_checkpoint_live(arena, cp)) {
+    return;
+  }
+  _arena_update_high_water(arena);
+  // Nothing has been taken from the free list since the checkpoint, so what
+  // was deallocated since is in front of where it was. Keep the blocks among
+  // those that were allocated before.
+  void *slot = arena->last_freed;
+  arena->last_freed = cp.last_freed;
+  arena->free_blocks = cp.free_blocks;
+  while (cp.last_freed != slot) {
+    void *next = _next_free(slot);
+    if (!_arena_allocated_since(arena, cp, slot)) {
+      __arena_dealloc(arena, slot);
+    }
+    slot = next;
+  }
+  arena->current = cp.current;
+  arena->next = cp.next;
+  arena->end = _CHAR_POINTER(cp.current->block) + cp.current->block_sz;
+  arena->carved_before_current = cp.carved_before_current;
+  --arena->checkpoints;
+}
+
+void __arena_commit(__Arena *arena, ArenaCheckpoint cp) {
+  ASSERT(NOT_NULL(arena), NOT_NULL(cp.current));
+  if (!_arena_checkpoint_live(arena, cp)) {
+    return;
+  }
+  --arena->checkpoints;
 }
 
 void *__arena_alloc(__Arena *arena) {
   ASSERT_NOT_NULL(arena);
   // Use up space that was already freed.
-  if (NULL != arena->last_freed) {
+  if (NULL != arena->last_freed && 0 == arena->checkpoints) {
     void *free_spot = arena->last_freed;
-    arena->last_freed = ((Descriptor *)free_spot)->prev_freed;
-    return _CHAR_POINTER(free_spot) + descriptor_sz;
+    arena->last_freed = _next_free(free_spot);
+    --arena->free_blocks;
+    return free_spot;
   }
-  // Allocate a new subarena if the current one is full.
   if (arena->next == arena->end) {
-    _Subarena *new_sa = _subarena_create(arena->last, arena->alloc_sz);
-    new_sa->prev = arena->last;
-    arena->last = new_sa;
-    arena->next = arena->last->block;
-    arena->end = _CHAR_POINTER(arena->last->block) + arena->last->block_sz;
+    _arena_advance(arena, 1);
   }
   void *spot = arena->next;
   arena->next = _CHAR_POINTER(arena->next) + arena->alloc_sz;
-  return _CHAR_POINTER(spot) + descriptor_sz;
+  return spot;
+}
+
+void *__arena_alloc_n(__Arena *arena, size_t n) {
+  ASSERT_NOT_NULL(arena);
+  size_t run_sz;
+  if (0 == n || __builtin_mul_overflow(n, arena->alloc_sz, &run_sz)) {
+    return NULL;
+  }
+  if (run_sz > (size_t)(_CHAR_POINTER(arena->end) -
+                        _CHAR_POINTER(arena->next))) {
+    // Keep the slots left in the current subarena for single allocations.
+    while (arena->next != arena->end) {
+      __arena_dealloc(arena, arena->next);
+      arena->next = _CHAR_POINTER(arena->next) + arena->alloc_sz;
+    }
+    _arena_advance(arena, n);
+  }
+  void *run = arena->next;
+  arena->next = _CHAR_POINTER(arena->next) + run_sz;
+  return run;
 }
 
 void __arena_dealloc(__Arena *arena, void *ptr) {
   ASSERT(NOT_NULL(arena), NOT_NULL(ptr));
-  Descriptor *d = (Descriptor *)(_CHAR_POINTER(ptr) - descriptor_sz);
-  d->prev_freed = arena->last_freed;
-  arena->last_freed = (void *)d;
+  _set_next_free(ptr, arena->last_freed);
+  arena->last_freed = ptr;
+  ++arena->free_blocks;
+}
+
+ArenaStats __arena_stats(const __Arena *arena) {
+  ASSERT_NOT_NULL(arena);
+  size_t carved = _arena_carved(arena);
+  size_t high_water = arena->high_water_blocks > carved
+                          ? arena->high_water_blocks
+                          : carved;
+  ArenaStats stats = {
+      .subarenas = arena->num_subarenas,
+      .reserved_bytes = arena->subarena_bytes,
+      .handed_out_bytes = carved * arena->alloc_sz,
+      .free_blocks = arena->free_blocks,
+      .free_bytes = arena->free_blocks * arena->alloc_sz,
+      .high_water_bytes = high_water * arena->alloc_sz};
+  return stats;
 }
@@ -51,8 +51,45 @@
 //     ARENA_INIT(MyType);
 //     ...
 //   }
-#define ARENA_INIT(typename) \
-  __arena_init(&__ARENA__##typename, sizeof(typename), #typename)
+#define ARENA_INIT(typename)                                \
+  __arena_init_with(&__ARENA__##typename, sizeof(typename), \
+                    _Alignof(typename), #typename, (ArenaOptions){0})
+
+// Controls how an arena's subarenas are sized. See ARENA_INIT_WITH().
+typedef struct {
+  // Elements in the first subarena. 0 for the default of 128.
+  size_t initial_elts;
+  // Each subarena holds this many times as many elements as the one before
+  // it. 0 or 1 keeps every subarena the same size.
+  size_t growth_factor;
+  // Most elements a subarena will hold. 0 for no limit.
+  size_t max_elts;
+  // Most elements whose subarenas are kept by ARENA_RESET(). 0 keeps all of
+  // them. Arenas with reserve_bytes set keep the rest without their memory.
+  size_t retain_elts;
+  // Bytes of address space to reserve for subarenas up front. 0 to allocate
+  // each subarena with malloc() instead. See ARENA_TRIM().
+  size_t reserve_bytes;
+} ArenaOptions;
+
+// Initializes an arena with the given ArenaOptions.
+//
+// Growing subarenas geometrically lets an arena that ends up holding millions
+// of elements do so in a handful of allocations, while one that stays small
+// does not reserve much.
+//
+// Usage:
+//   ARENA_DEFINE(MyType);
+//
+//   int main(int argc, char *argv[]) {
+//     const ArenaOptions opts = {
+//         .initial_elts = 1024, .growth_factor = 2, .max_elts = 1 << 20};
+//     ARENA_INIT_WITH(MyType, opts);
+//     ...
+//   }
+#define ARENA_INIT_WITH(typename, opts)                     \
+  __arena_init_with(&__ARENA__##typename, sizeof(typename), \
+                    _Alignof(typename), #typename, (opts))
 
 // Finalizes and does any tyding up related to an arena, freeing all memory at
 // once.
@@ -67,12 +104,186 @@
 //   }
 #define ARENA_FINALIZE(typename) __arena_finalize(&__ARENA__##typename)
 
+// Called on each block in use by ARENA_FOR_EACH() and ARENA_FINALIZE_WITH().
+typedef void (*ArenaAction)(void *ptr);
+
+// Calls [fn] on every block in the arena that is in use, in address order.
+//
+// Details:
+//   - A block is in use if it was allocated and has not been passed to
+//     ARENA_DEALLOC() since. ARENA_RESET() leaves none in use.
+//   - [fn] may ARENA_DEALLOC() the block it is given, but should not allocate
+//     from the arena.
+//   - Takes time in proportion to the blocks handed out plus the freed
+//     blocks times the log of the number of subarenas.
+//
+// Usage:
+//   void print_my_type(void *ptr) {
+//     MyType *t = (MyType *)ptr;
+//     ...
+//   }
+//   ...
+//   ARENA_FOR_EACH(MyType, print_my_type);
+#define ARENA_FOR_EACH(typename, fn) \
+  __arena_for_each(&__ARENA__##typename, (fn))
+
+// Calls [destructor] on every block in the arena that is in use, then frees
+// all memory at once. See ARENA_FOR_EACH() and ARENA_FINALIZE().
+//
+// Usage:
+//   ARENA_FINALIZE_WITH(MyType, my_type_finalize);
+#define ARENA_FINALIZE_WITH(typename, destructor) \
+  __arena_finalize_with(&__ARENA__##typename, (destructor))
+
+// Releases every block in an arena at once while keeping its memory for the
+// blocks allocated after.
+//
+// Details:
+//   - Takes constant time unless the arena's ArenaOptions set retain_elts, in
+//     which case the subarenas past that many elements are freed. The first
+//     subarena is always kept.
+//   - All pointers from the arena are invalid afterwards.
+//
+// Usage:
+//   ARENA_INIT(MyType);
+//   while (has_request()) {
+//     ... ARENA_ALLOC(MyType) ...
+//     ARENA_RESET(MyType);
+//   }
+//   ARENA_FINALIZE(MyType);
+#define ARENA_RESET(typename) __arena_reset(&__ARENA__##typename)
+
+// Gives the memory of every subarena with no blocks in use back to the OS.
+//
+// Details:
+//   - The subarenas are kept and are the next to be allocated from, so an
+//     arena that grows again reuses them before asking for more.
+//   - Takes time in proportion to the number of freed blocks.
+//   - Best used with ArenaOptions.reserve_bytes. Those subarenas are carved
+//     one after another from a single mapping, are given back whole, and are
+//     inaccessible until needed. Subarenas from malloc() only give back the
+//     pages they fully cover.
+//   - If the reservation runs out, subarenas come from malloc().
+//
+// Usage:
+//   const ArenaOptions opts = {.reserve_bytes = (size_t)1 << 32};
+//   ARENA_INIT_WITH(MyType, opts);
+//   ...
+//   ARENA_TRIM(MyType);
+#define ARENA_TRIM(typename) __arena_trim(&__ARENA__##typename)
+
+// Records the state of an arena so that everything allocated from it after can
+// be released at once with ARENA_ROLLBACK().
+//
+// Details:
+//   - Every checkpoint must end with either ARENA_ROLLBACK() or
+//     ARENA_COMMIT().
+//   - Deallocated blocks are not reused until every checkpoint has ended, so
+//     that the free list is still intact.
+//   - Checkpoints nest, and end in the reverse of the order they were taken.
+//   - ARENA_RESET() and ARENA_TRIM() end all checkpoints. Rolling back or
+//     committing one of them afterwards does nothing.
+//
+// Usage:
+//   ArenaCheckpoint cp = ARENA_CHECKPOINT(MyType);
+//   if (try_parse(...)) {
+//     ARENA_COMMIT(MyType, cp);
+//   } else {
+//     ARENA_ROLLBACK(MyType, cp);
+//   }
+#define ARENA_CHECKPOINT(typename) __arena_checkpoint(&__ARENA__##typename)
+
+// Releases every block allocated since [cp] was taken.
+//
+// Details:
+//   - Blocks allocated before [cp] and deallocated since stay deallocated.
+//   - Takes time in proportion to the blocks deallocated since [cp] was taken,
+//     times the number of subarenas started since.
+//   - The subarenas started since [cp] are kept for reuse, as with
+//     ARENA_RESET().
+//
+// Usage:
+//   ARENA_ROLLBACK(MyType, cp);
+#define ARENA_ROLLBACK(typename, cp) \
+  __arena_rollback(&__ARENA__##typename, (cp))
+
+// Ends [cp], keeping everything allocated since it was taken.
+//
+// Details:
+//   - Once no checkpoints remain, deallocated blocks are reused again.
+//
+// Usage:
+//   ARENA_COMMIT(MyType, cp);
+#define ARENA_COMMIT(typename, cp) __arena_commit(&__ARENA__##typename, (cp))
+
+// How an arena's memory is being used. See ARENA_STATS().
+typedef struct {
+  // Subarenas allocated, and the bytes in their blocks.
+  size_t subarenas;
+  size_t reserved_bytes;
+  // Bytes in blocks carved from the subarenas, whether in use or free. What is
+  // left of reserved_bytes has never been handed out.
+  size_t handed_out_bytes;
+  // Blocks in the free list, and the bytes in them. What is left of
+  // handed_out_bytes is in use.
+  size_t free_blocks;
+  size_t free_bytes;
+  // Most bytes handed out at once since the arena was initialized.
+  size_t high_water_bytes;
+} ArenaStats;
+
+// Returns an ArenaStats for the arena.
+//
+// Details:
+//   - Takes constant time, so it can be called as often as needed. The
+//     counts are updated as the arena is used.
+//   - Subarenas given back by ARENA_TRIM() still count toward
+//     reserved_bytes, since they are kept for reuse.
+//
+// Usage:
+//   ArenaStats stats = ARENA_STATS(MyType);
+//   printf("%zu bytes in the free list\n", stats.free_bytes);
+#define ARENA_STATS(typename) __arena_stats(&__ARENA__##typename)
+
 // Allocates a block in the arena and returns a pointer to it.
 //
+// Details:
+//   - Blocks are aligned for the type and packed back to back with no header,
+//     so an arena of N elements takes about N * sizeof(type) bytes. Types
+//     smaller than a pointer take a pointer's worth, rounded up to their
+//     alignment.
+//
 // Usage:
 //   MyType *t = ARENA_ALLOC(MyType);
 #define ARENA_ALLOC(typename) (typename *)__arena_alloc(&__ARENA__##typename)
 
+// Allocates [n] blocks that are adjacent in memory and returns a pointer to the
+// first, so that they can be used as an array.
+//
+// Details:
+//   - Opens a new subarena if the current one does not have room, in which
+//     case the blocks left in the current one are kept for ARENA_ALLOC().
+//   - Each block can be passed to ARENA_DEALLOC() on its own.
+//   - Does not compile for types smaller than a pointer. Their blocks are a
+//     pointer apart rather than sizeof(type), so they would not be an array.
+//   - Returns NULL if [n] is 0.
+//
+// Usage:
+//   MyType *batch = ARENA_ALLOC_N(MyType, 64);
+//   for (int i = 0; i < 64; ++i) {
+//     init(&batch[i]);
+//   }
+#define ARENA_ALLOC_N(typename, n)                                          \
+  (typename *)__arena_alloc_n(                                              \
+      &__ARENA__##typename,                                                 \
+      ((void)sizeof(struct {                                                \
+        _Static_assert(sizeof(typename) >= sizeof(void *),                  \
+                       "ARENA_ALLOC_N() needs a type at least as big as a " \
+                       "pointer, or its blocks are not an array.");         \
+        char unused;                                                        \
+      }),                                                                   \
+       (n)))
+
 // Deallocates a block in this arena.
 //
 // Generally, this is not the desired behavior of an arena, but this
@@ -84,20 +295,63 @@
 #define ARENA_DEALLOC(typename, ptr) __arena_dealloc(&__ARENA__##typename, ptr)
 
 typedef struct __Subarena _Subarena;
+typedef struct __Reservation _Reservation;
 
 typedef struct {
   bool inited;
   const char *name;
-  _Subarena *last;
+  // Subarenas in the order they were allocated. [current] is the one blocks
+  // are carved from, which is only before [last] after a reset.
+  _Subarena *first, *current, *last;
   size_t alloc_sz;
   void *next, *end;
+  // Freed slots, each holding a pointer to the one freed before it.
   void *last_freed;
+  size_t align;
+  ArenaOptions opts;
+  // NULL unless opts.reserve_bytes is set.
+  _Reservation *reservation;
+  // Checkpoints that have not been rolled back.
+  size_t checkpoints;
+  // Bumped by every reset and trim, which end all checkpoints.
+  size_t generation;
+  // Counts for ARENA_STATS().
+  size_t num_subarenas, subarena_bytes;
+  // Blocks carved from the subarenas before the current one.
+  size_t carved_before_current;
+  // Blocks in the free list.
+  size_t free_blocks;
+  // Most blocks carved at once, as of the last time that went down.
+  size_t high_water_blocks;
+  // Elements in the last subarena.
+  size_t last_elts;
 } __Arena;
 
+// The state of an arena. See ARENA_CHECKPOINT().
+typedef struct {
+  _Subarena *current;
+  void *next;
+  void *last_freed;
+  size_t carved_before_current, free_blocks;
+  // The arena's generation when this was taken.
+  size_t generation;
+} ArenaCheckpoint;
+
 // Do not call these function directly.
 void __arena_init(__Arena *arena, size_t sz, const char name[]);
+void __arena_init_with(__Arena *arena, size_t sz, size_t align,
+                       const char name[], ArenaOptions opts);
 void __arena_finalize(__Arena *arena);
+void __arena_reset(__Arena *arena);
+void __arena_trim(__Arena *arena);
+void __arena_for_each(__Arena *arena, ArenaAction fn);
+void __arena_finalize_with(__Arena *arena, ArenaAction destructor);
+ArenaCheckpoint __arena_checkpoint(__Arena *arena);
+void __arena_rollback(__Arena *arena, ArenaCheckpoint cp);
+void __arena_commit(__Arena *arena, ArenaCheckpoint cp);
+ArenaStats __arena_stats(const __Arena *arena);
 void *__arena_alloc(__Arena *arena);
+void *__arena_alloc_n(__Arena *arena, size_t n);
 void __arena_dealloc(__Arena *arena, void *ptr);
 
 #endif /* ALLOC_ARENA_ARENA_H_ */
@@ -0,0 +1,200 @@
+// concurrent_arena.c
+//
+// Created on: Oct 17, 2026
+//     Author: Jeff Manzione
+
+#include "alloc/arena/concurrent_arena.h"
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "alloc/alloc.h"
+#include "debug/debug.h"
+
+#define MIN_CHUNK_SZ (64 * 1024)
+// Fewest blocks in a chunk, which decides the chunk size for large types.
+#define MIN_ELTS_IN_CHUNK 64
+// Free slots hold a pointer to the next free slot. See arena.c.
+#define MIN_SLOT_SZ sizeof(void *)
+
+typedef struct __Chunk _Chunk;
+
+// The start of each chunk.
+struct __Chunk {
+  _ThreadHeap *owner;
+  // The owner's other chunks.
+  _Chunk *next;
+};
+
+struct __ThreadHeap {
+  __ConcurrentArena *arena;
+  // The heap's blocks are not reachable from any thread while this is true, so
+  // the next thread to need a heap takes it over.
+  bool abandoned;
+  _Chunk *chunks;
+  // The unallocated part of the newest chunk.
+  char *next, *end;
+  // Blocks freed by the owning thread.
+  void *local_free;
+  // Blocks freed by other threads. Only ever pushed onto one at a time or
+  // taken as a whole, so it is safe from ABA.
+  _Atomic(void *) remote_free;
+  // Next heap in the arena.
+  _ThreadHeap *next_heap;
+};
+
+static inline void *_next_free(void *slot) {
+  void *next;
+  memcpy(&next, slot, sizeof(void *));
+  return next;
+}
+
+static inline void _set_next_free(void *slot, void *next) {
+  memcpy(slot, &next, sizeof(void *));
+}
+
+static inline _Chunk *_chunk_of(const __ConcurrentArena *arena,
+                                const void *ptr) {
+  return (_Chunk *)((uintptr_t)ptr & ~(uintptr_t)(arena->chunk_sz - 1));
+}
+
+static inline size_t _first_slot_offset(const __ConcurrentArena *arena) {
+  return (sizeof(_Chunk) + arena->align - 1) & ~(arena->align - 1);
+}
+
+// Runs when a thread that used the arena exits.
+static void _thread_heap_abandon(void *arg) {
+  _ThreadHeap *heap = (_ThreadHeap *)arg;
+  pthread_mutex_lock(&heap->arena->lock);
+  heap->abandoned = true;
+  pthread_mutex_unlock(&heap->arena->lock);
+}
+
+void __concurrent_arena_init(__ConcurrentArena *arena, size_t sz, size_t align,
+                             const char name[]) {
+  ASSERT(NOT_NULL(arena), 0 == (align & (align - 1)));
+  arena->name = name;
+  arena->align = align;
+  if (sz < MIN_SLOT_SZ) {
+    sz = MIN_SLOT_SZ;
+  }
+  arena->alloc_sz = (sz + align - 1) & ~(align - 1);
+  arena->chunk_sz = MIN_CHUNK_SZ;
+  while (_first_slot_offset(arena) + MIN_ELTS_IN_CHUNK * arena->alloc_sz >
+         arena->chunk_sz) {
+    arena->chunk_sz *= 2;
+  }
+  pthread_key_create(&arena->key, _thread_heap_abandon);
+  pthread_mutex_init(&arena->lock, NULL);
+  arena->heaps = NULL;
+}
+
+void __concurrent_arena_finalize(__ConcurrentArena *arena) {
+  ASSERT_NOT_NULL(arena);
+  // Threads that are still running will not run the key's destructor.
+  pthread_key_delete(arena->key);
+  _ThreadHeap *heap = arena->heaps;
+  while (NULL != heap) {
+    _Chunk *chunk = heap->chunks;
+    while (NULL != chunk) {
+      _Chunk *next = chunk->next;
+      free(chunk);
+      chunk = next;
+    }
+    _ThreadHeap *next_heap = heap->next_heap;
+    DEALLOC(heap);
+    heap = next_heap;
+  }
+  arena->heaps = NULL;
+  pthread_mutex_destroy(&arena->lock);
+}
+
+// Gives the calling thread a heap, taking over one abandoned by an exited
+// thread if there is one.
+static _ThreadHeap *_thread_heap_acquire(__ConcurrentArena *arena) {
+  pthread_mutex_lock(&arena->lock);
+  _ThreadHeap *heap = arena->heaps;
+  while (NULL != heap && !heap->abandoned) {
+    heap = heap->next_heap;
+  }
+  if (NULL == heap) {
+    heap = ALLOC2(_ThreadHeap);
+    heap->arena = arena;
+    heap->chunks = NULL;
+    heap->next = heap->end = NULL;
+    heap->local_free = NULL;
+    atomic_init(&heap->remote_free, NULL);
+    heap->next_heap = arena->heaps;
+    arena->heaps = heap;
+  }
+  heap->abandoned = false;
+  pthread_mutex_unlock(&arena->lock);
+  pthread_setspecific(arena->key, heap);
+  return heap;
+}
+
+static inline _ThreadHeap *_thread_heap(__ConcurrentArena *arena) {
+  return (_ThreadHeap *)pthread_getspecific(arena->key);
+}
+
+// Refills [heap] when it has no free blocks or room left in its chunk, first
+// with the blocks other threads freed and then with a new chunk.
+static void *_concurrent_arena_alloc_slow(__ConcurrentArena *arena,
+                                          _ThreadHeap *heap) {
+  void *slot = atomic_exchange(&heap->remote_free, NULL);
+  if (NULL != slot) {
+    heap->local_free = _next_free(slot);
+    return slot;
+  }
+  _Chunk *chunk = NULL;
+  if (0 != posix_memalign((void **)&chunk, arena->chunk_sz, arena->chunk_sz)) {
+    return NULL;
+  }
+  chunk->owner = heap;
+  chunk->next = heap->chunks;
+  heap->chunks = chunk;
+  size_t offset = _first_slot_offset(arena);
+  size_t elts = (arena->chunk_sz - offset) / arena->alloc_sz;
+  char *first = (char *)chunk + offset;
+  heap->next = first + arena->alloc_sz;
+  heap->end = first + elts * arena->alloc_sz;
+  return first;
+}
+
+void *__concurrent_arena_alloc(__ConcurrentArena *arena) {
+  ASSERT_NOT_NULL(arena);
+  _ThreadHeap *heap = _thread_heap(arena);
+  if (NULL == heap) {
+    heap = _thread_heap_acquire(arena);
+  }
+  void *slot = heap->local_free;
+  if (NULL != slot) {
+    heap->local_free = _next_free(slot);
+    return slot;
+  }
+  if (heap->next != heap->end) {
+    slot = heap->next;
+    heap->next += arena->alloc_sz;
+    return slot;
+  }
+  return _concurrent_arena_alloc_slow(arena, heap);
+}
+
+void __concurrent_arena_dealloc(__ConcurrentArena *arena, void *ptr) {
+  ASSERT(NOT_NULL(arena), NOT_NULL(ptr));
+  _ThreadHeap *owner = _chunk_of(arena, ptr)->owner;
+  if (owner == _thread_heap(arena)) {
+    _set_next_free(ptr, owner->local_free);
+    owner->local_free = ptr;
+    return;
+  }
+  void *head = atomic_load_explicit(&owner->remote_free, memory_order_relaxed);
+  do {
+    _set_next_free(ptr, head);
+  } while (!atomic_compare_exchange_weak_explicit(
+      &owner->remote_free, &head, ptr, memory_order_release,
+      memory_order_relaxed));
+}
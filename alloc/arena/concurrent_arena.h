@@ -0,0 +1,104 @@
+// concurrent_arena.h
+//
+// Created on: Oct 17, 2026
+//     Author: Jeff Manzione
+//
+// An arena that any number of threads can allocate from and free to.
+//
+// Each thread allocates from chunks of its own with no atomics or locks, just
+// like a plain arena from alloc/arena/arena.h. A block can be freed by any
+// thread: the thread that allocated it reuses it directly, while other threads
+// push it onto a lock-free list that the owning thread takes over the next
+// time it runs out of room. A thread that exits leaves its chunks to the next
+// thread that starts using the arena.
+//
+// CONCURRENT_ARENA_DEFINE(MyType);
+// void fn() {
+//   CONCURRENT_ARENA_INIT(MyType);
+//   ... start workers that call CONCURRENT_ARENA_ALLOC(MyType) and
+//       CONCURRENT_ARENA_DEALLOC(MyType, ptr) ...
+//   ... join workers ...
+//   CONCURRENT_ARENA_FINALIZE(MyType);  // All freed at once.
+// }
+
+#ifndef ALLOC_ARENA_CONCURRENT_ARENA_H_
+#define ALLOC_ARENA_CONCURRENT_ARENA_H_
+
+#include <pthread.h>
+#include <stddef.h>
+
+// Declares a concurrent arena for the given type. See ARENA_DECLARE().
+//
+// Usage:
+//   CONCURRENT_ARENA_DECLARE(MyType);
+#define CONCURRENT_ARENA_DECLARE(typename) \
+  extern __ConcurrentArena __CONCURRENT_ARENA__##typename
+
+// Defines a concurrent arena for the given type. See ARENA_DEFINE().
+//
+// Usage:
+//   CONCURRENT_ARENA_DEFINE(MyType);
+#define CONCURRENT_ARENA_DEFINE(typename) \
+  __ConcurrentArena __CONCURRENT_ARENA__##typename
+
+// Initializes a concurrent arena so that it can allocate memory.
+//
+// Details:
+//   - Must be called before any thread uses the arena.
+//   - Each concurrent arena uses a pthread key, so at most a few hundred can
+//     be initialized at once.
+//
+// Usage:
+//   CONCURRENT_ARENA_INIT(MyType);
+#define CONCURRENT_ARENA_INIT(typename)                    \
+  __concurrent_arena_init(&__CONCURRENT_ARENA__##typename, \
+                          sizeof(typename), _Alignof(typename), #typename)
+
+// Frees all memory in a concurrent arena at once.
+//
+// Details:
+//   - No other thread may be using the arena.
+//
+// Usage:
+//   CONCURRENT_ARENA_FINALIZE(MyType);
+#define CONCURRENT_ARENA_FINALIZE(typename) \
+  __concurrent_arena_finalize(&__CONCURRENT_ARENA__##typename)
+
+// Allocates a block in the concurrent arena from the calling thread's chunks
+// and returns a pointer to it.
+//
+// Usage:
+//   MyType *t = CONCURRENT_ARENA_ALLOC(MyType);
+#define CONCURRENT_ARENA_ALLOC(typename) \
+  ((typename *)__concurrent_arena_alloc(&__CONCURRENT_ARENA__##typename))
+
+// Deallocates a block in the concurrent arena. May be called from any thread.
+//
+// Usage:
+//   CONCURRENT_ARENA_DEALLOC(MyType, t);
+#define CONCURRENT_ARENA_DEALLOC(typename, ptr) \
+  __concurrent_arena_dealloc(&__CONCURRENT_ARENA__##typename, (ptr))
+
+typedef struct __ThreadHeap _ThreadHeap;
+
+typedef struct {
+  const char *name;
+  size_t alloc_sz, align;
+  // Chunks are this large and aligned to it, so a block's chunk is found by
+  // masking its address.
+  size_t chunk_sz;
+  // The calling thread's _ThreadHeap.
+  pthread_key_t key;
+  // Guards [heaps] and which thread owns each of them.
+  pthread_mutex_t lock;
+  _ThreadHeap *heaps;
+} __ConcurrentArena;
+
+// Do not call these function directly.
+void __concurrent_arena_init(__ConcurrentArena *arena, size_t sz, size_t align,
+                             const char name[]);
+void __concurrent_arena_finalize(__ConcurrentArena *arena);
+void *__concurrent_arena_alloc(__ConcurrentArena *arena);
+void __concurrent_arena_dealloc(__ConcurrentArena *arena, void *ptr);
+
+#endif /* ALLOC_ARENA_CONCURRENT_ARENA_H_ */
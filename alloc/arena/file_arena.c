@@ -0,0 +1,192 @@
+// file_arena.c
+//
+// Created on: Oct 17, 2026
+//     Author: Jeff Manzione
+
+#include "alloc/arena/file_arena.h"
+
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "debug/debug.h"
+
+#define FILE_ARENA_VERSION 1
+// Bytes the file first grows to. It doubles each time it runs out after that.
+#define INITIAL_FILE_SZ (64 * 1024)
+
+struct __FileArenaHeader {
+  char magic[FILE_ARENA_MAGIC_SZ];
+  uint32_t version;
+  // sizeof(_FileArenaHeader) when the file was written, which must match.
+  uint32_t header_sz;
+  // Bytes in use, including the header.
+  uint64_t size;
+  FileRef root;
+};
+
+static inline _FileArenaHeader *_header(const FileArena *fa) {
+  return (_FileArenaHeader *)fa->base;
+}
+
+static inline size_t _page_round_up(size_t sz) {
+  size_t page_sz = sysconf(_SC_PAGESIZE);
+  return (sz + page_sz - 1) & ~(page_sz - 1);
+}
+
+bool file_arena_create(FileArena *fa, const char path[],
+                       size_t reserve_bytes) {
+  ASSERT(NOT_NULL(fa), NOT_NULL(path));
+  fa->map_sz = _page_round_up(reserve_bytes);
+  fa->file_sz = INITIAL_FILE_SZ < fa->map_sz ? INITIAL_FILE_SZ : fa->map_sz;
+  if (fa->map_sz < sizeof(_FileArenaHeader)) {
+    return false;
+  }
+  fa->fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if (fa->fd < 0) {
+    return false;
+  }
+  // Pages past the end of the file are mapped but fault if touched, so the
+  // file is grown before blocks are handed out from them.
+  fa->base = NULL;
+  if (0 == ftruncate(fa->fd, fa->file_sz)) {
+    void *base = mmap(NULL, fa->map_sz, PROT_READ | PROT_WRITE, MAP_SHARED,
+                      fa->fd, 0);
+    fa->base = MAP_FAILED == base ? NULL : (char *)base;
+  }
+  if (NULL == fa->base) {
+    close(fa->fd);
+    unlink(path);
+    return false;
+  }
+  fa->writable = true;
+  _FileArenaHeader *header = _header(fa);
+  memcpy(header->magic, FILE_ARENA_MAGIC, FILE_ARENA_MAGIC_SZ);
+  header->version = FILE_ARENA_VERSION;
+  header->header_sz = sizeof(_FileArenaHeader);
+  header->size = sizeof(_FileArenaHeader);
+  header->root = FILE_REF_NULL;
+  return true;
+}
+
+bool file_arena_open(FileArena *fa, const char path[]) {
+  ASSERT(NOT_NULL(fa), NOT_NULL(path));
+  fa->fd = open(path, O_RDONLY);
+  if (fa->fd < 0) {
+    return false;
+  }
+  struct stat st;
+  if (0 != fstat(fa->fd, &st) ||
+      (size_t)st.st_size < sizeof(_FileArenaHeader)) {
+    close(fa->fd);
+    return false;
+  }
+  fa->file_sz = fa->map_sz = st.st_size;
+  fa->writable = false;
+  void *base = mmap(NULL, fa->map_sz, PROT_READ, MAP_SHARED, fa->fd, 0);
+  if (MAP_FAILED == base) {
+    close(fa->fd);
+    return false;
+  }
+  fa->base = (char *)base;
+  const _FileArenaHeader *header = _header(fa);
+  if (0 != memcmp(header->magic, FILE_ARENA_MAGIC, FILE_ARENA_MAGIC_SZ) ||
+      FILE_ARENA_VERSION != header->version ||
+      sizeof(_FileArenaHeader) != header->header_sz ||
+      header->size > fa->file_sz || header->root >= header->size) {
+    munmap(fa->base, fa->map_sz);
+    close(fa->fd);
+    return false;
+  }
+  return true;
+}
+
+// Grows the file so that it holds at least [size] bytes.
+static bool _file_arena_grow(FileArena *fa, size_t size) {
+  size_t file_sz = fa->file_sz;
+  while (file_sz < size) {
+    file_sz *= 2;
+  }
+  if (file_sz > fa->map_sz) {
+    file_sz = fa->map_sz;
+  }
+  if (0 != ftruncate(fa->fd, file_sz)) {
+    return false;
+  }
+  fa->file_sz = file_sz;
+  return true;
+}
+
+void *file_arena_alloc(FileArena *fa, size_t bytes, size_t align) {
+  ASSERT(NOT_NULL(fa), 0 == (align & (align - 1)));
+  if (!fa->writable) {
+    return NULL;
+  }
+  _FileArenaHeader *header = _header(fa);
+  size_t offset = (header->size + align - 1) & ~(align - 1);
+  if (offset > fa->map_sz || bytes > fa->map_sz - offset) {
+    return NULL;
+  }
+  if (offset + bytes > fa->file_sz && !_file_arena_grow(fa, offset + bytes)) {
+    return NULL;
+  }
+  header->size = offset + bytes;
+  // New file pages read as zeros, so the block is already cleared.
+  return fa->base + offset;
+}
+
+FileRef file_arena_ref(const FileArena *fa, const void *ptr) {
+  return NULL == ptr ? FILE_REF_NULL : (FileRef)((const char *)ptr - fa->base);
+}
+
+const void *file_arena_deref_const(const FileArena *fa, FileRef ref,
+                                   size_t bytes) {
+  ASSERT_NOT_NULL(fa);
+  size_t size = _header(fa)->size;
+  // Also rejects FILE_REF_NULL, which is inside the header.
+  if (ref < sizeof(_FileArenaHeader) || ref > size || bytes > size - ref) {
+    return NULL;
+  }
+  return fa->base + ref;
+}
+
+void *file_arena_deref(const FileArena *fa, FileRef ref, size_t bytes) {
+  ASSERT_NOT_NULL(fa);
+  if (!fa->writable) {
+    return NULL;
+  }
+  return (void *)file_arena_deref_const(fa, ref, bytes);
+}
+
+bool file_arena_set_root(FileArena *fa, FileRef root) {
+  ASSERT_NOT_NULL(fa);
+  if (!fa->writable) {
+    return false;
+  }
+  _header(fa)->root = root;
+  return true;
+}
+
+FileRef file_arena_root(const FileArena *fa) {
+  ASSERT_NOT_NULL(fa);
+  return _header(fa)->root;
+}
+
+bool file_arena_close(FileArena *fa) {
+  ASSERT_NOT_NULL(fa);
+  bool ok = true;
+  if (fa->writable) {
+    size_t size = _header(fa)->size;
+    ok = 0 == msync(fa->base, size, MS_SYNC);
+    munmap(fa->base, fa->map_sz);
+    ok = 0 == ftruncate(fa->fd, size) && ok;
+  } else {
+    munmap(fa->base, fa->map_sz);
+  }
+  ok = 0 == close(fa->fd) && ok;
+  fa->base = NULL;
+  fa->fd = -1;
+  return ok;
+}
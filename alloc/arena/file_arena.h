@@ -0,0 +1,165 @@
+// file_arena.h
+//
+// Created on: Oct 17, 2026
+//     Author: Jeff Manzione
+//
+// An arena backed by a memory-mapped file, for structures that are built once
+// and then loaded by later processes without any deserialization.
+//
+// Blocks are carved one after another from the mapping like a region from
+// alloc/arena/region.h. Since the file will be mapped at a different address
+// each time, blocks refer to each other by FileRef, their offset from the start
+// of the file, rather than by pointer. A reader maps the file read-only and
+// shared, so every process that opens it shares the same pages in the page
+// cache.
+//
+// File format:
+//   - A header holding FILE_ARENA_MAGIC, the bytes in use and the root.
+//   - The blocks, each aligned as it was allocated.
+//
+// Usage:
+//   FileArena fa;
+//   file_arena_create(&fa, "graph.bin", (size_t)1 << 34);
+//   MyNode *root = FILE_ARENA_ALLOC(&fa, MyNode);
+//   MyNode *child = FILE_ARENA_ALLOC(&fa, MyNode);
+//   root->child = file_arena_ref(&fa, child);
+//   file_arena_set_root(&fa, file_arena_ref(&fa, root));
+//   file_arena_close(&fa);
+//   ...
+//   file_arena_open(&fa, "graph.bin");
+//   const MyNode *root = FILE_ARENA_ROOT_CONST(&fa, MyNode);
+//   const MyNode *child = FILE_ARENA_DEREF_CONST(&fa, MyNode, root->child);
+//   file_arena_close(&fa);
+
+#ifndef ALLOC_ARENA_FILE_ARENA_H_
+#define ALLOC_ARENA_FILE_ARENA_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define FILE_ARENA_MAGIC "ARENAFL1"
+#define FILE_ARENA_MAGIC_SZ 8
+
+// The offset of a block from the start of its file. FILE_REF_NULL refers to no
+// block.
+typedef uint64_t FileRef;
+
+#define FILE_REF_NULL ((FileRef)0)
+
+typedef struct __FileArenaHeader _FileArenaHeader;
+
+typedef struct {
+  int fd;
+  // The start of the mapping, which starts with the header.
+  char *base;
+  // Bytes of address space mapped, which for a writable arena may go past the
+  // end of the file.
+  size_t map_sz;
+  // Bytes in the file.
+  size_t file_sz;
+  bool writable;
+} FileArena;
+
+// Creates a file at [path] for a new arena, truncating it if it exists.
+//
+// Details:
+//   - [reserve_bytes] is the most the arena can hold. Address space is
+//     reserved for all of it up front so that blocks never move, while the
+//     file only grows as blocks are allocated.
+//   - Returns false if the file could not be created or mapped.
+bool file_arena_create(FileArena *fa, const char path[], size_t reserve_bytes);
+
+// Maps an arena written by file_arena_create() read-only.
+//
+// Details:
+//   - Returns false if the file could not be mapped or is not an arena.
+//   - Blocks must not be modified, so use FILE_ARENA_DEREF_CONST() and
+//     FILE_ARENA_ROOT_CONST() to reach them.
+bool file_arena_open(FileArena *fa, const char path[]);
+
+// Allocates [bytes] bytes aligned to [align] from a writable arena.
+//
+// Details:
+//   - [align] must be a power of 2 no larger than a page.
+//   - The memory is cleared.
+//   - Returns NULL if the arena is full or was mapped read-only by
+//     file_arena_open().
+void *file_arena_alloc(FileArena *fa, size_t bytes, size_t align);
+
+// Allocates a [type] from [fa]. See file_arena_alloc().
+//
+// Usage:
+//   MyStruct *s = FILE_ARENA_ALLOC(&fa, MyStruct);
+#define FILE_ARENA_ALLOC(fa, type) \
+  (type *)file_arena_alloc((fa), sizeof(type), _Alignof(type))
+
+// Allocates [count] elements of [type] from [fa]. See file_arena_alloc().
+//
+// Usage:
+//   MyStruct *arr = FILE_ARENA_ALLOC_ARRAY(&fa, MyStruct, 20);
+#define FILE_ARENA_ALLOC_ARRAY(fa, type, count) \
+  (type *)file_arena_alloc((fa), sizeof(type) * (count), _Alignof(type))
+
+// Returns the FileRef for [ptr], which must be in [fa] or NULL.
+FileRef file_arena_ref(const FileArena *fa, const void *ptr);
+
+// Returns the block of [bytes] bytes that [ref] refers to in a writable arena,
+// or NULL for FILE_REF_NULL.
+//
+// Details:
+//   - Returns NULL if the block would not be within the bytes in use, so a
+//     corrupt FileRef cannot reach outside of the arena.
+//   - Returns NULL if [fa] was mapped read-only by file_arena_open(), which
+//     must use file_arena_deref_const() instead.
+void *file_arena_deref(const FileArena *fa, FileRef ref, size_t bytes);
+
+// Like file_arena_deref(), but for any arena, including ones mapped read-only
+// by file_arena_open().
+const void *file_arena_deref_const(const FileArena *fa, FileRef ref,
+                                   size_t bytes);
+
+// Returns the [type] that [ref] refers to in a writable arena. See
+// file_arena_deref().
+//
+// Usage:
+//   MyStruct *s = FILE_ARENA_DEREF(&fa, MyStruct, parent->child);
+#define FILE_ARENA_DEREF(fa, type, ref) \
+  (type *)file_arena_deref((fa), (ref), sizeof(type))
+
+// Returns the [type] that [ref] refers to. See file_arena_deref_const().
+//
+// Usage:
+//   const MyStruct *s = FILE_ARENA_DEREF_CONST(&fa, MyStruct, parent->child);
+#define FILE_ARENA_DEREF_CONST(fa, type, ref) \
+  (const type *)file_arena_deref_const((fa), (ref), sizeof(type))
+
+// Records the block a reader should start from. Only one root is kept.
+//
+// Details:
+//   - Returns false, leaving the root unchanged, if [fa] was mapped read-only
+//     by file_arena_open().
+bool file_arena_set_root(FileArena *fa, FileRef root);
+
+// Returns the block recorded with file_arena_set_root().
+FileRef file_arena_root(const FileArena *fa);
+
+// Returns the root of a writable arena as a [type]. See file_arena_root().
+//
+// Usage:
+//   MyStruct *s = FILE_ARENA_ROOT(&fa, MyStruct);
+#define FILE_ARENA_ROOT(fa, type) \
+  FILE_ARENA_DEREF((fa), type, file_arena_root(fa))
+
+// Returns the root as a const [type]. See file_arena_root().
+//
+// Usage:
+//   const MyStruct *s = FILE_ARENA_ROOT_CONST(&fa, MyStruct);
+#define FILE_ARENA_ROOT_CONST(fa, type) \
+  FILE_ARENA_DEREF_CONST((fa), type, file_arena_root(fa))
+
+// Unmaps [fa]. A writable arena's file is first trimmed to the bytes in use
+// and flushed to disk. Returns false if that failed.
+bool file_arena_close(FileArena *fa);
+
+#endif /* ALLOC_ARENA_FILE_ARENA_H_ */
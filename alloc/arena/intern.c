@@ -10,6 +10,7 @@
 #include <string.h>
 
 #include "alloc/alloc.h"
+#include "alloc/scratch/scratch.h"
 #include "debug/debug.h"
 #include "struct/set.h"
 #include "util/util.h"
@@ -70,11 +71,12 @@ void intern_finalize() {
 }
 
 char *intern_range(const char str[], int start, int end) {
-  char *tmp = ALLOC_ARRAY(char, end - start + 1);
+  ScratchMark mark = scratch_mark();
+  char *tmp = SCRATCH_ALLOC_ARRAY(char, end - start + 1);
   strncpy(tmp, str + start, end - start);
   tmp[end - start] = '\0';
   char *to_return = intern(tmp);
-  DEALLOC(tmp);
+  scratch_reset(mark);
   return to_return;
 }
 
@@ -0,0 +1,118 @@
+// region.c
+//
+// Created on: Oct 17, 2026
+//     Author: Jeff Manzione
+
+#include "alloc/arena/region.h"
+
+#include <stdint.h>
+
+#include "alloc/arena/subarena.h"
+#include "debug/debug.h"
+
+#define DEFAULT_CHUNK_SZ (64 * 1024)
+
+// Returns the first address at or after [ptr] aligned to [align].
+static inline char *_align_up(char *ptr, size_t align) {
+  return (char *)(((uintptr_t)ptr + align - 1) & ~(uintptr_t)(align - 1));
+}
+
+static void _region_use_subarena(Region *region, _Subarena *sa) {
+  region->current = sa;
+  region->next = (char *)sa->block;
+  region->end = (char *)sa->block + sa->block_sz;
+}
+
+void region_init(Region *region, size_t chunk_sz) {
+  ASSERT_NOT_NULL(region);
+  region->chunk_sz = 0 == chunk_sz ? DEFAULT_CHUNK_SZ : chunk_sz;
+  region->first = region->last =
+      _subarena_create(region->chunk_sz, _Alignof(max_align_t));
+  _region_use_subarena(region, region->first);
+  region->oversized = region->spare_oversized = NULL;
+}
+
+// Returns a subarena of its own for a block that needs [needed] bytes, which is
+// more than a chunk. Takes the smallest spare one that fits, if any.
+static _Subarena *_region_oversized(Region *region, size_t needed) {
+  _Subarena **best = NULL;
+  for (_Subarena **link = &region->spare_oversized; NULL != *link;
+       link = &(*link)->next) {
+    if ((*link)->block_sz >= needed &&
+        (NULL == best || (*link)->block_sz < (*best)->block_sz)) {
+      best = link;
+    }
+  }
+  _Subarena *sa;
+  if (NULL == best) {
+    sa = _subarena_create(needed, _Alignof(max_align_t));
+  } else {
+    sa = *best;
+    *best = sa->next;
+  }
+  sa->next = region->oversized;
+  region->oversized = sa;
+  return sa;
+}
+
+// Moves on to the subarena after the current one, inserting a new one if there
+// is none.
+//
+// A block too big for a chunk is put in a subarena of its own instead, so that
+// the rest of the current one is still used for the blocks after.
+static void *_region_alloc_slow(Region *region, size_t bytes, size_t align) {
+  // Blocks are aligned to max_align_t, so only greater alignments need room to
+  // move the pointer forward.
+  size_t needed = bytes;
+  if (align > _Alignof(max_align_t) &&
+      __builtin_add_overflow(bytes, align - 1, &needed)) {
+    return NULL;
+  }
+  if (needed > region->chunk_sz) {
+    return _align_up((char *)_region_oversized(region, needed)->block, align);
+  }
+  _Subarena *sa = region->current->next;
+  if (NULL == sa) {
+    sa = _subarena_create(region->chunk_sz, _Alignof(max_align_t));
+    sa->next = region->current->next;
+    region->current->next = sa;
+    if (region->last == region->current) {
+      region->last = sa;
+    }
+  }
+  _region_use_subarena(region, sa);
+  char *ptr = _align_up(region->next, align);
+  region->next = ptr + bytes;
+  return ptr;
+}
+
+void *region_alloc(Region *region, size_t bytes, size_t align) {
+  ASSERT(NOT_NULL(region), 0 != align, 0 == (align & (align - 1)));
+  char *ptr = _align_up(region->next, align);
+  if (ptr <= region->end && bytes <= (size_t)(region->end - ptr)) {
+    region->next = ptr + bytes;
+    return ptr;
+  }
+  return _region_alloc_slow(region, bytes, align);
+}
+
+void region_reset(Region *region) {
+  ASSERT_NOT_NULL(region);
+  _region_use_subarena(region, region->first);
+  while (NULL != region->oversized) {
+    _Subarena *sa = region->oversized;
+    region->oversized = sa->next;
+    sa->next = region->spare_oversized;
+    region->spare_oversized = sa;
+  }
+}
+
+void region_finalize(Region *region) {
+  ASSERT_NOT_NULL(region);
+  _subarena_delete_all(region->first);
+  _subarena_delete_all(region->oversized);
+  _subarena_delete_all(region->spare_oversized);
+  region->first = region->current = region->last = NULL;
+  region->oversized = region->spare_oversized = NULL;
+  region->next = region->end = NULL;
+}
@@ -0,0 +1,78 @@
+// region.h
+//
+// Created on: Oct 17, 2026
+//     Author: Jeff Manzione
+//
+// An arena for objects of any size and type.
+//
+// Where an arena from alloc/arena/arena.h holds elements of one type, a region
+// hands out blocks of whatever size and alignment is asked for, so a whole
+// object graph of mixed types, strings and arrays can be allocated from one
+// region and released at once. Allocating is a pointer bump, and individual
+// blocks are never freed.
+//
+// Usage:
+//   Region region;
+//   region_init(&region, 0);
+//   MyStruct *s = REGION_ALLOC(&region, MyStruct);
+//   s->items = REGION_ALLOC_ARRAY(&region, Item, s->num_items);
+//   ...
+//   region_finalize(&region);  // All freed at once.
+
+#ifndef ALLOC_ARENA_REGION_H_
+#define ALLOC_ARENA_REGION_H_
+
+#include <stddef.h>
+
+typedef struct __Subarena _Subarena;
+
+typedef struct {
+  // Subarenas in the order they were allocated. [current] is the one blocks
+  // are carved from, which is only before [last] after a reset.
+  _Subarena *first, *current, *last;
+  // The unallocated part of current.
+  char *next, *end;
+  // Subarenas that each hold a single block too big for a chunk, and those
+  // released by a reset for reuse.
+  _Subarena *oversized, *spare_oversized;
+  size_t chunk_sz;
+} Region;
+
+// Initializes [region] to allocate from chunks of [chunk_sz] bytes.
+//
+// Details:
+//   - 0 for the default of 64 KiB.
+//   - Blocks larger than a chunk get a chunk of their own, and the blocks
+//     after are still carved from the chunk that was in use.
+void region_init(Region *region, size_t chunk_sz);
+
+// Allocates [bytes] bytes from [region] aligned to [align].
+//
+// Details:
+//   - [align] must be a power of 2.
+//   - The memory is not cleared.
+//   - Valid until region_reset() or region_finalize() is called.
+void *region_alloc(Region *region, size_t bytes, size_t align);
+
+// Allocates a [type] from [region]. See region_alloc().
+//
+// Usage:
+//   MyStruct *s = REGION_ALLOC(&region, MyStruct);
+#define REGION_ALLOC(region, type) \
+  (type *)region_alloc((region), sizeof(type), _Alignof(type))
+
+// Allocates [count] elements of [type] from [region]. See region_alloc().
+//
+// Usage:
+//   MyStruct *arr = REGION_ALLOC_ARRAY(&region, MyStruct, 20);
+#define REGION_ALLOC_ARRAY(region, type, count) \
+  (type *)region_alloc((region), sizeof(type) * (count), _Alignof(type))
+
+// Releases everything allocated from [region] at once while keeping its chunks
+// for the blocks allocated after.
+void region_reset(Region *region);
+
+// Frees everything allocated from [region].
+void region_finalize(Region *region);
+
+#endif /* ALLOC_ARENA_REGION_H_ */
@@ -0,0 +1,97 @@
+// subarena.c
+//
+// Created on: Oct 17, 2026
+//     Author: Jeff Manzione
+
+#include "alloc/arena/subarena.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "alloc/alloc.h"
+#include "debug/debug.h"
+
+_Subarena *_subarena_create(size_t block_sz, size_t align) {
+  _Subarena *sa = ALLOC2(_Subarena);
+  sa->block_sz = block_sz;
+  if (align <= _Alignof(max_align_t)) {
+    sa->block = malloc(sa->block_sz);
+  } else if (0 != posix_memalign(&sa->block, align, sa->block_sz)) {
+    sa->block = NULL;
+  }
+  ASSERT_NOT_NULL(sa->block);
+  sa->next = NULL;
+  sa->reserved = false;
+  return sa;
+}
+
+static inline size_t _page_round_up(size_t sz) {
+  size_t page_sz = sysconf(_SC_PAGESIZE);
+  return (sz + page_sz - 1) & ~(page_sz - 1);
+}
+
+_Subarena *_subarena_create_reserved(_Reservation *res, size_t block_sz,
+                                     size_t align) {
+  size_t map_sz = _page_round_up(block_sz);
+  if (NULL == res->start || align > (size_t)sysconf(_SC_PAGESIZE) ||
+      map_sz > (size_t)(res->end - res->next) ||
+      0 != mprotect(res->next, map_sz, PROT_READ | PROT_WRITE)) {
+    return NULL;
+  }
+  _Subarena *sa = ALLOC2(_Subarena);
+  sa->block = res->next;
+  sa->block_sz = block_sz;
+  sa->next = NULL;
+  sa->reserved = true;
+  res->next += map_sz;
+  return sa;
+}
+
+void _subarena_decommit(_Subarena *sa) {
+  if (!sa->reserved) {
+    // Only whole pages can be given back, and malloc() may have put something
+    // else in the first and last.
+    size_t page_sz = sysconf(_SC_PAGESIZE);
+    char *start = (char *)_page_round_up((uintptr_t)sa->block);
+    char *end = (char *)(((uintptr_t)sa->block + sa->block_sz) &
+                         ~(uintptr_t)(page_sz - 1));
+    if (start < end) {
+      madvise(start, end - start, MADV_DONTNEED);
+    }
+    return;
+  }
+  madvise(sa->block, _page_round_up(sa->block_sz), MADV_DONTNEED);
+}
+
+void _subarena_delete_all(_Subarena *sa) {
+  while (NULL != sa) {
+    _Subarena *next = sa->next;
+    if (!sa->reserved) {
+      free(sa->block);
+    }
+    DEALLOC(sa);
+    sa = next;
+  }
+}
+
+bool _reservation_init(_Reservation *res, size_t sz) {
+  sz = _page_round_up(sz);
+  void *start = mmap(NULL, sz, PROT_NONE,
+                     MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, /*fd=*/-1, 0);
+  if (MAP_FAILED == start) {
+    res->start = res->next = res->end = NULL;
+    return false;
+  }
+  res->start = res->next = (char *)start;
+  res->end = res->start + sz;
+  return true;
+}
+
+void _reservation_release(_Reservation *res) {
+  if (NULL != res->start) {
+    munmap(res->start, res->end - res->start);
+  }
+  res->start = res->next = res->end = NULL;
+}
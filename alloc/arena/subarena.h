@@ -0,0 +1,58 @@
+// subarena.h
+//
+// Created on: Oct 17, 2026
+//     Author: Jeff Manzione
+//
+// The blocks of memory that arenas and regions carve their allocations from,
+// kept in a list in the order they were created.
+//
+// Blocks come from malloc() or, for arenas that reserve address space up front,
+// are carved one after another from a _Reservation.
+
+#ifndef ALLOC_ARENA_SUBARENA_H_
+#define ALLOC_ARENA_SUBARENA_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+
+typedef struct __Subarena _Subarena;
+
+struct __Subarena {
+  _Subarena *next;
+  void *block;
+  size_t block_sz;
+  // True if [block] is in a _Reservation rather than from malloc().
+  bool reserved;
+};
+
+typedef struct __Reservation _Reservation;
+
+// A range of address space that is inaccessible until subarenas are carved
+// from it.
+struct __Reservation {
+  char *start, *next, *end;
+};
+
+// Creates a subarena whose block has [block_sz] bytes aligned to [align].
+_Subarena *_subarena_create(size_t block_sz, size_t align);
+
+// Creates a subarena from the next [block_sz] bytes of [res], or returns NULL
+// if there are not that many left or [align] is larger than a page.
+_Subarena *_subarena_create_reserved(_Reservation *res, size_t block_sz,
+                                     size_t align);
+
+// Gives the pages of [sa]'s block back to the OS. The block stays usable and
+// reads as zeros until written.
+void _subarena_decommit(_Subarena *sa);
+
+// Deletes [sa] and every subarena after it. Blocks in a _Reservation are left
+// to _reservation_release().
+void _subarena_delete_all(_Subarena *sa);
+
+// Reserves [sz] bytes of address space. Returns false if it could not be.
+bool _reservation_init(_Reservation *res, size_t sz);
+
+// Unmaps [res] along with the blocks of every subarena carved from it.
+void _reservation_release(_Reservation *res);
+
+#endif /* ALLOC_ARENA_SUBARENA_H_ */
@@ -0,0 +1,241 @@
+// event_log.c
+//
+// Created on: Oct 17, 2026
+//     Author: Jeff Manzione
+
+#include "alloc/event_log.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "alloc/site.h"
+#include "debug/debug.h"
+
+// Number of events the ring buffer can hold. Must be a power of 2.
+#define RING_SZ (1 << 16)
+// Events copied out of the ring per write.
+#define WRITE_BATCH_SZ 1024
+// How long the writer sleeps when the ring is empty.
+#define WRITER_IDLE_NS (1000 * 1000)
+#define FILE_BUFFER_SZ (1 << 20)
+
+// A ring buffer slot. [seq] tells producers and the consumer whose turn it is
+// to use the slot, following Vyukov's bounded queue.
+typedef struct {
+  _Atomic uint64_t seq;
+  AllocEvent event;
+} _Slot;
+
+typedef struct {
+  _Slot slots[RING_SZ];
+  _Alignas(64) _Atomic uint64_t enqueue_pos;
+  _Alignas(64) uint64_t dequeue_pos;
+  _Atomic uint64_t dropped;
+} _Ring;
+
+// Never freed, so a thread that saw the log running just before it stopped can
+// still safely finish writing its event. Untouched pages are never resident.
+static _Ring _ring_storage;
+static _Ring *const _ring = &_ring_storage;
+static bool _ring_inited = false;
+_Atomic bool __alloc_event_log_running = false;
+static _Atomic bool _stop_requested = false;
+// Producers that saw the log running and have not finished publishing their
+// event. The log waits for this to reach 0 when stopping, so that the writer's
+// final pass sees every event that was claimed.
+static _Alignas(64) _Atomic uint64_t _in_flight = 0;
+static pthread_t _writer;
+static FILE *_file = NULL;
+static struct timespec _start_time;
+// Sites that have been written to the log so far.
+static uint32_t _sites_written = 0;
+
+static _Atomic uint16_t _next_thread_id = 1;
+static __thread uint16_t _thread_id = 0;
+
+static uint64_t _now() {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t)(now.tv_sec - _start_time.tv_sec) * 1000000000ull +
+         (now.tv_nsec - _start_time.tv_nsec);
+}
+
+// Pushes an event into the ring, or counts it as dropped if the ring is full.
+static void _push(AllocEventOp op, const void *ptr, const void *old_ptr,
+                  uint64_t size, uint32_t site_id) {
+  if (0 == _thread_id) {
+    _thread_id = atomic_fetch_add(&_next_thread_id, 1);
+  }
+  uint64_t pos =
+      atomic_load_explicit(&_ring->enqueue_pos, memory_order_relaxed);
+  _Slot *slot;
+  while (true) {
+    slot = &_ring->slots[pos & (RING_SZ - 1)];
+    uint64_t seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+    if (seq == pos) {
+      if (atomic_compare_exchange_weak_explicit(&_ring->enqueue_pos, &pos,
+                                                pos + 1, memory_order_relaxed,
+                                                memory_order_relaxed)) {
+        break;
+      }
+    } else if (seq < pos) {
+      // The writer has not caught up, so drop rather than block.
+      atomic_fetch_add_explicit(&_ring->dropped, 1, memory_order_relaxed);
+      return;
+    } else {
+      pos = atomic_load_explicit(&_ring->enqueue_pos, memory_order_relaxed);
+    }
+  }
+  AllocEvent *event = &slot->event;
+  event->timestamp = _now();
+  event->ptr = (uint64_t)(uintptr_t)ptr;
+  event->old_ptr = (uint64_t)(uintptr_t)old_ptr;
+  event->size = size;
+  event->site_id = site_id;
+  event->thread_id = _thread_id;
+  event->op = op;
+  event->reserved = 0;
+  atomic_store_explicit(&slot->seq, pos + 1, memory_order_release);
+}
+
+void alloc_event_log_record(AllocEventOp op, const void *ptr,
+                            const void *old_ptr, uint64_t size,
+                            uint32_t site_id) {
+  if (!atomic_load_explicit(&__alloc_event_log_running, memory_order_relaxed)) {
+    return;
+  }
+  // Announce the event before checking again, so that either
+  // alloc_event_log_stop() waits for it or it sees that the log stopped.
+  atomic_fetch_add(&_in_flight, 1);
+  if (atomic_load(&__alloc_event_log_running)) {
+    _push(op, ptr, old_ptr, size, site_id);
+  }
+  atomic_fetch_sub_explicit(&_in_flight, 1, memory_order_release);
+}
+
+// Writes definitions for any sites interned since the last call.
+static void _write_new_sites() {
+  uint32_t num_sites = alloc_site_count();
+  for (; _sites_written < num_sites; ++_sites_written) {
+    uint32_t site_id = _sites_written + 1;
+    const AllocSite *site = alloc_site(site_id);
+    size_t type_name_sz = strlen(site->type_name) + 1;
+    size_t func_sz = strlen(site->func) + 1;
+    size_t file_sz = strlen(site->file) + 1;
+    AllocEvent event = {.timestamp = _now(),
+                        .ptr = site->line,
+                        .size = type_name_sz + func_sz + file_sz,
+                        .site_id = site_id,
+                        .op = ALLOC_EVENT_SITE};
+    fwrite(&event, sizeof(AllocEvent), 1, _file);
+    fwrite(site->type_name, 1, type_name_sz, _file);
+    fwrite(site->func, 1, func_sz, _file);
+    fwrite(site->file, 1, file_sz, _file);
+  }
+}
+
+// Moves up to [max] events out of the ring into [events]. Returns the number
+// moved.
+static int _drain(AllocEvent events[], int max) {
+  int num_events = 0;
+  for (; num_events < max; ++num_events) {
+    _Slot *slot = &_ring->slots[_ring->dequeue_pos & (RING_SZ - 1)];
+    uint64_t seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+    if (seq != _ring->dequeue_pos + 1) {
+      break;
+    }
+    events[num_events] = slot->event;
+    atomic_store_explicit(&slot->seq, _ring->dequeue_pos + RING_SZ,
+                          memory_order_release);
+    _ring->dequeue_pos++;
+  }
+  return num_events;
+}
+
+static void _write_dropped() {
+  uint64_t dropped =
+      atomic_exchange_explicit(&_ring->dropped, 0, memory_order_relaxed);
+  if (0 == dropped) {
+    return;
+  }
+  AllocEvent event = {
+      .timestamp = _now(), .size = dropped, .op = ALLOC_EVENT_DROPPED};
+  fwrite(&event, sizeof(AllocEvent), 1, _file);
+}
+
+static void *_writer_main(void *arg) {
+  AllocEvent *events = malloc(sizeof(AllocEvent) * WRITE_BATCH_SZ);
+  ASSERT_NOT_NULL(events);
+  while (true) {
+    // Read the flag first so that everything pushed before stopping is
+    // drained by the final pass.
+    bool stopping = atomic_load(&_stop_requested);
+    int num_events = _drain(events, WRITE_BATCH_SZ);
+    if (num_events > 0) {
+      // Sites referenced by these events were interned before the events were
+      // pushed, so they are defined before being used.
+      _write_new_sites();
+      fwrite(events, sizeof(AllocEvent), num_events, _file);
+    }
+    _write_dropped();
+    if (num_events == WRITE_BATCH_SZ) {
+      continue;
+    }
+    if (stopping) {
+      break;
+    }
+    struct timespec idle = {.tv_sec = 0, .tv_nsec = WRITER_IDLE_NS};
+    nanosleep(&idle, NULL);
+  }
+  free(events);
+  return NULL;
+}
+
+bool alloc_event_log_start(const char path[]) {
+  ASSERT_NOT_NULL(path);
+  if (atomic_load(&__alloc_event_log_running)) {
+    return false;
+  }
+  _file = fopen(path, "wb");
+  if (NULL == _file) {
+    return false;
+  }
+  setvbuf(_file, NULL, _IOFBF, FILE_BUFFER_SZ);
+  fwrite(ALLOC_EVENT_LOG_MAGIC, 1, ALLOC_EVENT_LOG_MAGIC_SZ, _file);
+  if (!_ring_inited) {
+    for (uint64_t i = 0; i < RING_SZ; ++i) {
+      atomic_init(&_ring->slots[i].seq, i);
+    }
+    _ring_inited = true;
+  }
+  _sites_written = 0;
+  clock_gettime(CLOCK_MONOTONIC, &_start_time);
+  atomic_store(&_stop_requested, false);
+  if (0 != pthread_create(&_writer, NULL, _writer_main, NULL)) {
+    fclose(_file);
+    _file = NULL;
+    return false;
+  }
+  atomic_store(&__alloc_event_log_running, true);
+  return true;
+}
+
+void alloc_event_log_stop() {
+  if (!atomic_load(&__alloc_event_log_running)) {
+    return;
+  }
+  atomic_store(&__alloc_event_log_running, false);
+  // Producers finish in moments, so yielding is enough.
+  while (0 != atomic_load_explicit(&_in_flight, memory_order_acquire)) {
+    sched_yield();
+  }
+  atomic_store(&_stop_requested, true);
+  pthread_join(_writer, NULL);
+  fclose(_file);
+  _file = NULL;
+}
@@ -0,0 +1,87 @@
+// event_log.h
+//
+// Created on: Oct 17, 2026
+//     Author: Jeff Manzione
+//
+// Records allocation events to a file in a compact binary format.
+//
+// Allocating threads push fixed-size events into a lock-free ring buffer and a
+// background thread drains it to the file, so recording an event costs about
+// as much as a clock read and a compare-and-swap. If the writer falls behind
+// and the ring fills up, events are dropped rather than blocking the
+// allocating thread, and the number dropped is written to the log.
+//
+// Log format:
+//   - ALLOC_EVENT_LOG_MAGIC.
+//   - A sequence of AllocEvents. An ALLOC_EVENT_SITE event is followed by
+//     [size] bytes holding the null-terminated type name, function, and file
+//     of the site, in that order.
+//
+// Use //alloc:alloc_log_decode to print a log in a readable form.
+
+#ifndef ALLOC_EVENT_LOG_H_
+#define ALLOC_EVENT_LOG_H_
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#define ALLOC_EVENT_LOG_MAGIC "ALLOCLG1"
+#define ALLOC_EVENT_LOG_MAGIC_SZ 8
+
+typedef enum {
+  // [ptr] was allocated with [size] bytes.
+  ALLOC_EVENT_ALLOC = 1,
+  // [old_ptr] was reallocated to [ptr] with [size] bytes.
+  ALLOC_EVENT_REALLOC = 2,
+  // [ptr] was freed.
+  ALLOC_EVENT_DEALLOC = 3,
+  // Defines [site_id], which was allocated from line [ptr].
+  ALLOC_EVENT_SITE = 4,
+  // [size] events were dropped because the ring buffer was full.
+  ALLOC_EVENT_DROPPED = 5,
+} AllocEventOp;
+
+typedef struct {
+  // Nanoseconds since the log was started.
+  uint64_t timestamp;
+  uint64_t ptr;
+  uint64_t old_ptr;
+  uint64_t size;
+  // ALLOC_NO_SITE (0) if the block is not attributed to a site.
+  uint32_t site_id;
+  // Small sequential id of the thread that recorded the event.
+  uint16_t thread_id;
+  // An AllocEventOp.
+  uint8_t op;
+  uint8_t reserved;
+} AllocEvent;
+
+// Starts recording events to [path], truncating it. Returns false if the file
+// could not be opened or the log is already running.
+bool alloc_event_log_start(const char path[]);
+
+// Stops recording and writes out every event that was recorded before it
+// stopped, waiting for threads that are in the middle of recording one.
+void alloc_event_log_stop();
+
+// Records an event if the log is running.
+void alloc_event_log_record(AllocEventOp op, const void *ptr,
+                            const void *old_ptr, uint64_t size,
+                            uint32_t site_id);
+
+// Like alloc_event_log_record(), but does not make the call unless the log is
+// running. For allocation paths where the call itself would be noticeable.
+#define ALLOC_EVENT_LOG_RECORD(op, ptr, old_ptr, size, site_id)          \
+  do {                                                                   \
+    if (atomic_load_explicit(&__alloc_event_log_running,                 \
+                             memory_order_relaxed)) {                    \
+      alloc_event_log_record((op), (ptr), (old_ptr), (size), (site_id)); \
+    }                                                                    \
+  } while (0)
+
+// True while the log is running. Use ALLOC_EVENT_LOG_RECORD() rather than
+// reading it directly.
+extern _Atomic bool __alloc_event_log_running;
+
+#endif /* ALLOC_EVENT_LOG_H_ */
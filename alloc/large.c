@@ -0,0 +1,304 @@
+// large.c
+//
+// Created on: Oct 17, 2026
+//     Author: Jeff Manzione
+//
+// Blocks for ALLOC_ARRAY_LARGE() and ALLOC_ARRAY_HUGE(), each in its own
+// anonymous mapping.
+//
+// Growing a block with mremap() moves its pages rather than copying them, and
+// the pages it gains are zero pages from the kernel, so REALLOC_LARGE() does
+// not depend on the size of the block.
+//
+// Huge blocks are mapped in multiples of HUGE_PAGE_SZ at addresses aligned to
+// it and advised with MADV_HUGEPAGE, so that the kernel can back them with
+// transparent huge pages.
+
+// For mremap().
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "alloc/alloc.h"
+
+// Bytes in front of each block. Starts with its _LargeHeader and ends with
+// room for the _AllocInfo that tracked builds put right before each block.
+// Also keeps blocks cache-line aligned.
+#define LARGE_HEADER_SZ 64
+#define HUGE_PAGE_SZ (2 * 1024 * 1024)
+
+typedef struct __LargeHeader _LargeHeader;
+
+struct __LargeHeader {
+  // Bytes mapped, including the header.
+  size_t map_sz;
+  // Bytes requested. Everything in the mapping past this is zero.
+  size_t size;
+  // Neighbors in _huge_blocks. Unused by blocks that are not huge.
+  _LargeHeader *prev, *next;
+  // True if allocated by ALLOC_ARRAY_HUGE().
+  bool huge;
+  // True if the kernel accepted MADV_HUGEPAGE for the mapping.
+  bool advised;
+};
+
+static size_t _page_sz = 0;
+// Bytes mapped for huge blocks, and how many of them were advised.
+static atomic_size_t _huge_mapped_bytes = 0, _huge_advised_bytes = 0;
+// Every live huge block, so that alloc_huge_stats() can pick their mappings
+// out of /proc/self/smaps.
+static _LargeHeader *_huge_blocks = NULL;
+static pthread_mutex_t _huge_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static inline size_t _map_size(size_t size, bool huge) {
+  if (0 == _page_sz) {
+    _page_sz = sysconf(_SC_PAGESIZE);
+  }
+  size_t align = huge ? HUGE_PAGE_SZ : _page_sz;
+  return (LARGE_HEADER_SZ + size + align - 1) & ~(align - 1);
+}
+
+// Maps [map_sz] bytes at an address aligned to HUGE_PAGE_SZ by mapping extra
+// and trimming the ends.
+static void *_map_huge_aligned(size_t map_sz) {
+  char *raw = mmap(NULL, map_sz + HUGE_PAGE_SZ, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS, /*fd=*/-1, 0);
+  if (MAP_FAILED == raw) {
+    return NULL;
+  }
+  char *base = (char *)(((uintptr_t)raw + HUGE_PAGE_SZ - 1) &
+                        ~(uintptr_t)(HUGE_PAGE_SZ - 1));
+  if (base > raw) {
+    munmap(raw, base - raw);
+  }
+  char *raw_end = raw + map_sz + HUGE_PAGE_SZ;
+  if (raw_end > base + map_sz) {
+    munmap(base + map_sz, raw_end - (base + map_sz));
+  }
+  return base;
+}
+
+static bool _advise_huge(void *base, size_t map_sz) {
+#ifdef MADV_HUGEPAGE
+  return 0 == madvise(base, map_sz, MADV_HUGEPAGE);
+#else
+  return false;
+#endif
+}
+
+// Adds or removes [header]'s mapping from the huge block counters and from
+// _huge_blocks. Must be removed before the mapping moves.
+static void _huge_count(_LargeHeader *header, bool add) {
+  if (!header->huge) {
+    return;
+  }
+  pthread_mutex_lock(&_huge_lock);
+  if (add) {
+    header->prev = NULL;
+    header->next = _huge_blocks;
+    if (NULL != _huge_blocks) {
+      _huge_blocks->prev = header;
+    }
+    _huge_blocks = header;
+  } else {
+    if (NULL == header->prev) {
+      _huge_blocks = header->next;
+    } else {
+      header->prev->next = header->next;
+    }
+    if (NULL != header->next) {
+      header->next->prev = header->prev;
+    }
+  }
+  pthread_mutex_unlock(&_huge_lock);
+  if (add) {
+    atomic_fetch_add(&_huge_mapped_bytes, header->map_sz);
+  } else {
+    atomic_fetch_sub(&_huge_mapped_bytes, header->map_sz);
+  }
+  if (header->advised && add) {
+    atomic_fetch_add(&_huge_advised_bytes, header->map_sz);
+  } else if (header->advised) {
+    atomic_fetch_sub(&_huge_advised_bytes, header->map_sz);
+  }
+}
+
+static inline _LargeHeader *_large_header(void *ptr) {
+  return (_LargeHeader *)((char *)ptr - LARGE_HEADER_SZ);
+}
+
+void *__large_alloc(size_t size, bool huge) {
+  size_t map_sz = _map_size(size, huge);
+  void *base = NULL;
+  if (huge) {
+    base = _map_huge_aligned(map_sz);
+  } else {
+    base = mmap(NULL, map_sz, PROT_READ | PROT_WRITE,
+                MAP_PRIVATE | MAP_ANONYMOUS, /*fd=*/-1, 0);
+    base = MAP_FAILED == base ? NULL : base;
+  }
+  if (NULL == base) {
+    return NULL;
+  }
+  _LargeHeader *header = (_LargeHeader *)base;
+  header->map_sz = map_sz;
+  header->size = size;
+  header->huge = huge;
+  // Without transparent huge pages the block is simply made of normal pages.
+  header->advised = huge && _advise_huge(base, map_sz);
+  _huge_count(header, /*add=*/true);
+  return (char *)base + LARGE_HEADER_SZ;
+}
+
+// Grows or shrinks the mapping at [header] to [map_sz]. Huge blocks that
+// cannot grow in place are moved to a new aligned address.
+static _LargeHeader *_remap(_LargeHeader *header, size_t map_sz) {
+  void *base = mremap(header, header->map_sz, map_sz,
+                      header->huge ? 0 : MREMAP_MAYMOVE);
+  if (MAP_FAILED != base) {
+    return (_LargeHeader *)base;
+  }
+  if (!header->huge) {
+    return NULL;
+  }
+  void *target = _map_huge_aligned(map_sz);
+  if (NULL == target) {
+    return NULL;
+  }
+  base = mremap(header, header->map_sz, map_sz,
+                MREMAP_MAYMOVE | MREMAP_FIXED, target);
+  if (MAP_FAILED == base) {
+    munmap(target, map_sz);
+    return NULL;
+  }
+  return (_LargeHeader *)base;
+}
+
+void *__large_realloc(void *ptr, size_t size) {
+  if (NULL == ptr) {
+    return __large_alloc(size, /*huge=*/false);
+  }
+  _LargeHeader *header = _large_header(ptr);
+  size_t old_size = header->size;
+  size_t map_sz = _map_size(size, header->huge);
+  if (map_sz != header->map_sz) {
+    _huge_count(header, /*add=*/false);
+    _LargeHeader *new_header = _remap(header, map_sz);
+    if (NULL == new_header) {
+      _huge_count(header, /*add=*/true);
+      return NULL;
+    }
+    header = new_header;
+    header->map_sz = map_sz;
+    if (header->huge) {
+      header->advised = _advise_huge(header, map_sz);
+    }
+    _huge_count(header, /*add=*/true);
+    ptr = (char *)header + LARGE_HEADER_SZ;
+  }
+  if (size < old_size) {
+    // Clear what is left of the old contents in the last page so that growing
+    // the block again exposes only zeros.
+    size_t capacity = map_sz - LARGE_HEADER_SZ;
+    memset((char *)ptr + size, 0,
+           (old_size < capacity ? old_size : capacity) - size);
+  }
+  header->size = size;
+  return ptr;
+}
+
+void __large_free(void *ptr) {
+  if (NULL == ptr) {
+    return;
+  }
+  _LargeHeader *header = _large_header(ptr);
+  _huge_count(header, /*add=*/false);
+  munmap(header, header->map_sz);
+}
+
+// The addresses [start, end) of a huge block's mapping.
+typedef struct {
+  unsigned long start, end;
+} _HugeRange;
+
+// Returns how many bytes of [start, end) are in the [num_ranges] [ranges].
+static size_t _huge_overlap(const _HugeRange ranges[], size_t num_ranges,
+                            unsigned long start, unsigned long end) {
+  size_t overlap = 0;
+  for (size_t i = 0; i < num_ranges; ++i) {
+    unsigned long lo = ranges[i].start > start ? ranges[i].start : start;
+    unsigned long hi = ranges[i].end < end ? ranges[i].end : end;
+    if (lo < hi) {
+      overlap += hi - lo;
+    }
+  }
+  return overlap;
+}
+
+// Sums AnonHugePages over the mappings in /proc/self/smaps that hold huge
+// blocks.
+//
+// The kernel may merge a block's mapping with neighboring anonymous memory,
+// in which case the mapping only counts in proportion to how much of it the
+// blocks cover.
+static size_t _huge_block_page_bytes() {
+  pthread_mutex_lock(&_huge_lock);
+  size_t num_ranges = 0;
+  for (_LargeHeader *h = _huge_blocks; NULL != h; h = h->next) {
+    ++num_ranges;
+  }
+  _HugeRange *ranges =
+      0 == num_ranges ? NULL : malloc(sizeof(_HugeRange) * num_ranges);
+  size_t i = 0;
+  for (_LargeHeader *h = _huge_blocks; NULL != ranges && NULL != h;
+       h = h->next) {
+    ranges[i].start = (unsigned long)h;
+    ranges[i].end = (unsigned long)h + h->map_sz;
+    ++i;
+  }
+  pthread_mutex_unlock(&_huge_lock);
+  FILE *smaps = NULL == ranges ? NULL : fopen("/proc/self/smaps", "r");
+  if (NULL == smaps) {
+    free(ranges);
+    return 0;
+  }
+  char line[256];
+  unsigned long start = 0, end = 0;
+  size_t total = 0, kb = 0;
+  while (NULL != fgets(line, sizeof(line), smaps)) {
+    unsigned long next_start, next_end;
+    if (2 == sscanf(line, "%lx-%lx ", &next_start, &next_end)) {
+      start = next_start;
+      end = next_end;
+    } else if (1 == sscanf(line, "AnonHugePages: %zu kB", &kb)) {
+      continue;
+    } else if (0 == strncmp(line, "VmFlags:", 8)) {
+      size_t overlap = 0 == kb ? 0 : _huge_overlap(ranges, i, start, end);
+      if (overlap == end - start) {
+        total += kb * 1024;
+      } else if (overlap > 0) {
+        total += (size_t)((double)kb * 1024 * overlap / (end - start));
+      }
+      kb = 0;
+    }
+  }
+  fclose(smaps);
+  free(ranges);
+  return total;
+}
+
+AllocHugeStats alloc_huge_stats() {
+  AllocHugeStats stats = {
+      .mapped_bytes = atomic_load(&_huge_mapped_bytes),
+      .advised_bytes = atomic_load(&_huge_advised_bytes),
+      .huge_page_bytes = _huge_block_page_bytes()};
+  return stats;
+}
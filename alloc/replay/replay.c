@@ -0,0 +1,470 @@
+// replay.c
+//
+// Created on: Oct 17, 2026
+//     Author: Jeff Manzione
+//
+// Replays an allocation log recorded by alloc_log_start() against several
+// allocators and reports their throughput and peak RSS.
+//
+// The log is first compiled into a dense list of operations on numbered slots
+// so that the replay itself does no bookkeeping beyond an array index. Each
+// backend is then run in a forked child so that peak RSS is measured
+// independently for each. Events from all recorded threads are replayed on a
+// single thread in the order they were logged.
+//
+// Usage:
+//   replay_benchmark <log_file> [repetitions]
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "alloc/alloc.h"
+#include "alloc/arena/arena.h"
+#include "alloc/event_log.h"
+#include "alloc/slab/slab.h"
+#include "debug/debug.h"
+#include "struct/map.h"
+#include "struct/struct_defaults.h"
+
+#define PAGE_SZ 4096
+
+typedef enum {
+  OP_ALLOC,
+  OP_REALLOC,
+  OP_DEALLOC,
+} _OpType;
+
+typedef struct {
+  _OpType type;
+  uint32_t slot;
+  uint64_t size;
+} _Op;
+
+typedef struct {
+  _Op *ops;
+  uint64_t num_ops, ops_cap;
+  uint32_t num_slots;
+  uint64_t num_skipped, num_dropped;
+  uint64_t peak_live_bytes;
+} _Trace;
+
+// An allocator under test.
+typedef struct {
+  const char *name;
+  void (*init)();
+  void *(*alloc)(uint64_t size);
+  void *(*realloc)(void *ptr, uint64_t old_size, uint64_t new_size);
+  void (*free)(void *ptr, uint64_t size);
+  void (*finalize)();
+} _Backend;
+
+// libc.
+void _libc_init() {}
+void *_libc_alloc(uint64_t size) { return malloc(size); }
+void *_libc_realloc(void *ptr, uint64_t old_size, uint64_t new_size) {
+  return realloc(ptr, new_size);
+}
+void _libc_free(void *ptr, uint64_t size) { free(ptr); }
+void _libc_finalize() {}
+
+// Size-classed allocators share these classes. Anything larger goes to libc.
+#define CLASS_GRANULARITY 16
+#define MAX_CLASS_SZ 1024
+#define NUM_CLASSES (MAX_CLASS_SZ / CLASS_GRANULARITY)
+
+static inline int _size_class(uint64_t size) {
+  return 0 == size ? 0 : (size - 1) / CLASS_GRANULARITY;
+}
+
+static inline uint64_t _class_size(int size_class) {
+  return (size_class + 1) * CLASS_GRANULARITY;
+}
+
+void *_sized_realloc(const _Backend *backend, void *ptr, uint64_t old_size,
+                     uint64_t new_size) {
+  if (old_size > MAX_CLASS_SZ && new_size > MAX_CLASS_SZ) {
+    return realloc(ptr, new_size);
+  }
+  if (old_size <= MAX_CLASS_SZ && new_size <= MAX_CLASS_SZ &&
+      _size_class(old_size) == _size_class(new_size)) {
+    return ptr;
+  }
+  void *new_ptr = backend->alloc(new_size);
+  memcpy(new_ptr, ptr, old_size < new_size ? old_size : new_size);
+  backend->free(ptr, old_size);
+  return new_ptr;
+}
+
+// One __Arena per size class.
+static __Arena _arenas[NUM_CLASSES];
+extern const _Backend ARENA_BACKEND;
+
+void _arena_init() {
+  for (int i = 0; i < NUM_CLASSES; ++i) {
+    __arena_init(&_arenas[i], _class_size(i), "replay");
+  }
+}
+void *_arena_alloc(uint64_t size) {
+  if (size > MAX_CLASS_SZ) {
+    return malloc(size);
+  }
+  return __arena_alloc(&_arenas[_size_class(size)]);
+}
+void *_arena_realloc(void *ptr, uint64_t old_size, uint64_t new_size) {
+  return _sized_realloc(&ARENA_BACKEND, ptr, old_size, new_size);
+}
+void _arena_free(void *ptr, uint64_t size) {
+  if (size > MAX_CLASS_SZ) {
+    free(ptr);
+    return;
+  }
+  __arena_dealloc(&_arenas[_size_class(size)], ptr);
+}
+void _arena_finalize() {
+  for (int i = 0; i < NUM_CLASSES; ++i) {
+    __arena_finalize(&_arenas[i]);
+  }
+}
+
+// A minimal slab allocator: per-class free lists carved from 64 KiB slabs.
+#define SLAB_SZ (64 * 1024)
+
+typedef struct __FreeObj _FreeObj;
+struct __FreeObj {
+  _FreeObj *next;
+};
+
+typedef struct {
+  _FreeObj *free_list;
+  char *next, *end;
+} _SlabClass;
+
+static _SlabClass _slab_classes[NUM_CLASSES];
+static void **_slabs = NULL;
+static uint64_t _num_slabs = 0, _slabs_cap = 0;
+extern const _Backend SLAB_BACKEND;
+
+void _slab_init() { memset(_slab_classes, 0, sizeof(_slab_classes)); }
+void *_slab_alloc(uint64_t size) {
+  if (size > MAX_CLASS_SZ) {
+    return malloc(size);
+  }
+  _SlabClass *sc = &_slab_classes[_size_class(size)];
+  if (NULL != sc->free_list) {
+    _FreeObj *obj = sc->free_list;
+    sc->free_list = obj->next;
+    return obj;
+  }
+  uint64_t obj_sz = _class_size(_size_class(size));
+  if (sc->next + obj_sz > sc->end) {
+    if (_num_slabs == _slabs_cap) {
+      _slabs_cap = 0 == _slabs_cap ? 64 : _slabs_cap * 2;
+      _slabs = realloc(_slabs, sizeof(void *) * _slabs_cap);
+    }
+    sc->next = _slabs[_num_slabs++] = malloc(SLAB_SZ);
+    sc->end = sc->next + SLAB_SZ;
+  }
+  void *obj = sc->next;
+  sc->next += obj_sz;
+  return obj;
+}
+void *_slab_realloc(void *ptr, uint64_t old_size, uint64_t new_size) {
+  return _sized_realloc(&SLAB_BACKEND, ptr, old_size, new_size);
+}
+void _slab_free(void *ptr, uint64_t size) {
+  if (size > MAX_CLASS_SZ) {
+    free(ptr);
+    return;
+  }
+  _SlabClass *sc = &_slab_classes[_size_class(size)];
+  _FreeObj *obj = (_FreeObj *)ptr;
+  obj->next = sc->free_list;
+  sc->free_list = obj;
+}
+void _slab_finalize() {
+  for (uint64_t i = 0; i < _num_slabs; ++i) {
+    free(_slabs[i]);
+  }
+  free(_slabs);
+  _slabs = NULL;
+  _num_slabs = _slabs_cap = 0;
+}
+
+// alloc/slab with its thread caches.
+void _slab_tc_init() {}
+void *_slab_tc_alloc(uint64_t size) { return ALLOC_SLAB_BACKEND.malloc(size); }
+void *_slab_tc_realloc(void *ptr, uint64_t old_size, uint64_t new_size) {
+  return ALLOC_SLAB_BACKEND.realloc(ptr, new_size);
+}
+void _slab_tc_free(void *ptr, uint64_t size) { ALLOC_SLAB_BACKEND.free(ptr); }
+void _slab_tc_finalize() {}
+
+const _Backend LIBC_BACKEND = {"libc",       _libc_init, _libc_alloc,
+                               _libc_realloc, _libc_free, _libc_finalize};
+const _Backend ARENA_BACKEND = {"arena",        _arena_init, _arena_alloc,
+                                _arena_realloc, _arena_free, _arena_finalize};
+const _Backend SLAB_BACKEND = {"slab",        _slab_init, _slab_alloc,
+                               _slab_realloc, _slab_free, _slab_finalize};
+
+const _Backend SLAB_TC_BACKEND = {
+    "slab_tc",     _slab_tc_init,    _slab_tc_alloc, _slab_tc_realloc,
+    _slab_tc_free, _slab_tc_finalize};
+
+static const _Backend *_BACKENDS[] = {&LIBC_BACKEND, &ARENA_BACKEND,
+                                      &SLAB_BACKEND, &SLAB_TC_BACKEND};
+#define NUM_BACKENDS (sizeof(_BACKENDS) / sizeof(_BACKENDS[0]))
+
+void _trace_add(_Trace *trace, _OpType type, uint32_t slot, uint64_t size) {
+  if (trace->num_ops == trace->ops_cap) {
+    trace->ops_cap = 0 == trace->ops_cap ? 1024 : trace->ops_cap * 2;
+    trace->ops = (NULL == trace->ops)
+                     ? ALLOC_ARRAY2(_Op, trace->ops_cap)
+                     : REALLOC(trace->ops, _Op, trace->ops_cap);
+  }
+  _Op *op = &trace->ops[trace->num_ops++];
+  op->type = type;
+  op->slot = slot;
+  op->size = size;
+}
+
+// Compiles the log at [path] into [trace]. Returns false if the file is not a
+// readable allocation log.
+bool _trace_load(_Trace *trace, const char path[]) {
+  FILE *file = fopen(path, "rb");
+  if (NULL == file) {
+    return false;
+  }
+  char magic[ALLOC_EVENT_LOG_MAGIC_SZ];
+  if (ALLOC_EVENT_LOG_MAGIC_SZ !=
+          fread(magic, 1, ALLOC_EVENT_LOG_MAGIC_SZ, file) ||
+      0 != memcmp(magic, ALLOC_EVENT_LOG_MAGIC, ALLOC_EVENT_LOG_MAGIC_SZ)) {
+    fclose(file);
+    return false;
+  }
+  // Live pointers in the log mapped to 1 + their slot.
+  Map live;
+  map_init_default(&live);
+  // Size of the block in each slot, since dealloc events do not carry it.
+  uint64_t *slot_sizes = NULL, slot_sizes_cap = 0;
+  uint64_t live_bytes = 0;
+  AllocEvent event;
+  while (1 == fread(&event, sizeof(AllocEvent), 1, file)) {
+    const void *ptr = (const void *)(uintptr_t)event.ptr;
+    switch (event.op) {
+      case ALLOC_EVENT_SITE:
+        fseek(file, event.size, SEEK_CUR);
+        break;
+      case ALLOC_EVENT_DROPPED:
+        trace->num_dropped += event.size;
+        break;
+      case ALLOC_EVENT_ALLOC: {
+        uint32_t slot = trace->num_slots++;
+        if (slot == slot_sizes_cap) {
+          slot_sizes_cap = 0 == slot_sizes_cap ? 1024 : slot_sizes_cap * 2;
+          slot_sizes = (NULL == slot_sizes)
+                           ? ALLOC_ARRAY2(uint64_t, slot_sizes_cap)
+                           : REALLOC(slot_sizes, uint64_t, slot_sizes_cap);
+        }
+        slot_sizes[slot] = event.size;
+        map_insert(&live, ptr, (void *)(uintptr_t)(slot + 1));
+        _trace_add(trace, OP_ALLOC, slot, event.size);
+        live_bytes += event.size;
+        break;
+      }
+      case ALLOC_EVENT_REALLOC: {
+        Pair old = map_remove(&live, (void *)(uintptr_t)event.old_ptr);
+        if (NULL == old.value) {
+          trace->num_skipped++;
+          break;
+        }
+        uint32_t slot = (uint32_t)(uintptr_t)old.value - 1;
+        map_insert(&live, ptr, old.value);
+        _trace_add(trace, OP_REALLOC, slot, event.size);
+        live_bytes += event.size - slot_sizes[slot];
+        slot_sizes[slot] = event.size;
+        break;
+      }
+      case ALLOC_EVENT_DEALLOC: {
+        Pair old = map_remove(&live, ptr);
+        if (NULL == old.value) {
+          trace->num_skipped++;
+          break;
+        }
+        uint32_t slot = (uint32_t)(uintptr_t)old.value - 1;
+        _trace_add(trace, OP_DEALLOC, slot, event.size);
+        live_bytes -= slot_sizes[slot];
+        break;
+      }
+      default:
+        trace->num_skipped++;
+        break;
+    }
+    if (live_bytes > trace->peak_live_bytes) {
+      trace->peak_live_bytes = live_bytes;
+    }
+  }
+  if (NULL != slot_sizes) {
+    DEALLOC(slot_sizes);
+  }
+  map_finalize(&live);
+  fclose(file);
+  return true;
+}
+
+// Sizes of live slots, so reallocs and frees of sized backends know the old
+// size. Sizes in the log are of the new block for reallocs.
+typedef struct {
+  void **ptrs;
+  uint64_t *sizes;
+} _Slots;
+
+// Writes one byte per page of the new part of a block, as a real program
+// would when filling it, so that RSS reflects the allocator's layout.
+static inline void _touch(char *ptr, uint64_t from, uint64_t to) {
+  for (uint64_t i = from; i < to; i += PAGE_SZ) {
+    ptr[i] = 1;
+  }
+  if (to > from) {
+    ptr[to - 1] = 1;
+  }
+}
+
+// Runs [trace] against [backend] and returns the elapsed nanoseconds.
+uint64_t _replay(const _Trace *trace, const _Backend *backend,
+                 _Slots *slots) {
+  struct timespec start, end;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  backend->init();
+  for (uint64_t i = 0; i < trace->num_ops; ++i) {
+    const _Op *op = &trace->ops[i];
+    switch (op->type) {
+      case OP_ALLOC:
+        slots->ptrs[op->slot] = backend->alloc(op->size);
+        slots->sizes[op->slot] = op->size;
+        _touch(slots->ptrs[op->slot], 0, op->size);
+        break;
+      case OP_REALLOC:
+        slots->ptrs[op->slot] = backend->realloc(
+            slots->ptrs[op->slot], slots->sizes[op->slot], op->size);
+        _touch(slots->ptrs[op->slot], slots->sizes[op->slot], op->size);
+        slots->sizes[op->slot] = op->size;
+        break;
+      case OP_DEALLOC:
+        backend->free(slots->ptrs[op->slot], slots->sizes[op->slot]);
+        slots->ptrs[op->slot] = NULL;
+        break;
+    }
+  }
+  // Free the blocks still live at the end of the log through the backend, so
+  // that backends whose finalize() does not release them do not carry them
+  // into the next repetition.
+  for (uint32_t slot = 0; slot < trace->num_slots; ++slot) {
+    if (NULL != slots->ptrs[slot]) {
+      backend->free(slots->ptrs[slot], slots->sizes[slot]);
+      slots->ptrs[slot] = NULL;
+    }
+  }
+  backend->finalize();
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  return (end.tv_sec - start.tv_sec) * 1000000000ull +
+         (end.tv_nsec - start.tv_nsec);
+}
+
+typedef struct {
+  uint64_t best_ns;
+  long peak_rss_kb, baseline_rss_kb;
+} _Result;
+
+// Replays [trace] in a child process so that its peak RSS is its own.
+bool _run_backend(const _Trace *trace, const _Backend *backend,
+                  int repetitions, _Result *result) {
+  int fds[2];
+  if (0 != pipe(fds)) {
+    return false;
+  }
+  pid_t pid = fork();
+  if (pid < 0) {
+    return false;
+  }
+  if (0 == pid) {
+    close(fds[0]);
+    _Slots slots = {.ptrs = calloc(trace->num_slots + 1, sizeof(void *)),
+                    .sizes = calloc(trace->num_slots + 1, sizeof(uint64_t))};
+    // Touch the trace so it is part of the baseline rather than the peak.
+    volatile uint64_t sum = 0;
+    for (uint64_t i = 0; i < trace->num_ops; i += PAGE_SZ / sizeof(_Op)) {
+      sum += trace->ops[i].size;
+    }
+    memset(slots.ptrs, 0, sizeof(void *) * (trace->num_slots + 1));
+    memset(slots.sizes, 0, sizeof(uint64_t) * (trace->num_slots + 1));
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    _Result child = {.best_ns = UINT64_MAX,
+                     .baseline_rss_kb = usage.ru_maxrss};
+    for (int i = 0; i < repetitions; ++i) {
+      uint64_t ns = _replay(trace, backend, &slots);
+      if (ns < child.best_ns) {
+        child.best_ns = ns;
+      }
+    }
+    getrusage(RUSAGE_SELF, &usage);
+    child.peak_rss_kb = usage.ru_maxrss;
+    ssize_t written = write(fds[1], &child, sizeof(_Result));
+    _exit(written == sizeof(_Result) ? 0 : 1);
+  }
+  close(fds[1]);
+  ssize_t num_read = read(fds[0], result, sizeof(_Result));
+  close(fds[0]);
+  int status;
+  waitpid(pid, &status, 0);
+  return num_read == sizeof(_Result) && WIFEXITED(status) &&
+         0 == WEXITSTATUS(status);
+}
+
+int main(int argc, const char *argv[]) {
+  if (argc < 2 || argc > 3) {
+    fprintf(stderr, "Usage: %s <log_file> [repetitions]\n", argv[0]);
+    return 1;
+  }
+  int repetitions = argc == 3 ? atoi(argv[2]) : 3;
+  if (repetitions < 1) {
+    repetitions = 1;
+  }
+  alloc_init();
+  _Trace trace;
+  memset(&trace, 0, sizeof(_Trace));
+  if (!_trace_load(&trace, argv[1])) {
+    fprintf(stderr, "Could not read allocation log '%s'.\n", argv[1]);
+    return 1;
+  }
+  printf("%lu operations on %u blocks, peak %lu live bytes.\n",
+         (unsigned long)trace.num_ops, trace.num_slots,
+         (unsigned long)trace.peak_live_bytes);
+  if (trace.num_dropped > 0 || trace.num_skipped > 0) {
+    printf("Warning: %lu events were dropped while recording and %lu could "
+           "not be matched, so the replay is approximate.\n",
+           (unsigned long)trace.num_dropped, (unsigned long)trace.num_skipped);
+  }
+  printf("%-8s %12s %10s %14s\n", "backend", "total_ms", "ns/op",
+         "peak_rss_kb");
+  for (int i = 0; i < NUM_BACKENDS; ++i) {
+    _Result result;
+    if (!_run_backend(&trace, _BACKENDS[i], repetitions, &result)) {
+      printf("%-8s failed\n", _BACKENDS[i]->name);
+      continue;
+    }
+    printf("%-8s %12.3f %10.1f %14ld\n", _BACKENDS[i]->name,
+           result.best_ns / 1e6,
+           trace.num_ops > 0 ? (double)result.best_ns / trace.num_ops : 0.0,
+           result.peak_rss_kb - result.baseline_rss_kb);
+  }
+  if (NULL != trace.ops) {
+    DEALLOC(trace.ops);
+  }
+  alloc_finalize();
+  return 0;
+}
@@ -0,0 +1,122 @@
+// scratch.c
+//
+// Created on: Oct 17, 2026
+//     Author: Jeff Manzione
+
+#include "alloc/scratch/scratch.h"
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#define DEFAULT_CHUNK_SZ (64 * 1024)
+
+struct __ScratchChunk {
+  // Chunks after this one are kept after a reset for reuse.
+  _ScratchChunk *next;
+  char *end;
+  _Alignas(max_align_t) char block[];
+};
+
+typedef struct {
+  // True once the thread's destructor has been set up.
+  bool registered;
+  _ScratchChunk *first, *current;
+  // The unallocated part of current.
+  char *next, *end;
+} _ThreadScratch;
+
+static pthread_once_t _key_once = PTHREAD_ONCE_INIT;
+// Used only for its destructor, which frees a thread's chunks on exit.
+static pthread_key_t _key;
+static __thread _ThreadScratch _scratch;
+
+static inline size_t _round_up(size_t size) {
+  return (size + _Alignof(max_align_t) - 1) & ~(_Alignof(max_align_t) - 1);
+}
+
+static void _thread_scratch_free(void *arg) {
+  _ThreadScratch *scratch = (_ThreadScratch *)arg;
+  _ScratchChunk *chunk = scratch->first;
+  while (NULL != chunk) {
+    _ScratchChunk *next = chunk->next;
+    free(chunk);
+    chunk = next;
+  }
+  scratch->first = scratch->current = NULL;
+  scratch->next = scratch->end = NULL;
+  scratch->registered = false;
+}
+
+static void _key_create() { pthread_key_create(&_key, _thread_scratch_free); }
+
+static _ScratchChunk *_chunk_create(size_t size, _ScratchChunk *next) {
+  size_t chunk_sz = sizeof(_ScratchChunk) + size;
+  if (chunk_sz < DEFAULT_CHUNK_SZ) {
+    chunk_sz = DEFAULT_CHUNK_SZ;
+  }
+  _ScratchChunk *chunk = (_ScratchChunk *)malloc(chunk_sz);
+  if (NULL == chunk) {
+    return NULL;
+  }
+  chunk->next = next;
+  chunk->end = (char *)chunk + chunk_sz;
+  return chunk;
+}
+
+// Moves on to the chunk after the current one, creating it if there is none
+// or if it is too small for [size].
+static void *_scratch_alloc_slow(size_t size) {
+  if (!_scratch.registered) {
+    pthread_once(&_key_once, _key_create);
+    pthread_setspecific(_key, &_scratch);
+    _scratch.registered = true;
+  }
+  _ScratchChunk *prev = _scratch.current;
+  _ScratchChunk *chunk = NULL == prev ? _scratch.first : prev->next;
+  if (NULL == chunk || (size_t)(chunk->end - chunk->block) < size) {
+    chunk = _chunk_create(size, chunk);
+    if (NULL == chunk) {
+      return NULL;
+    }
+    if (NULL == prev) {
+      _scratch.first = chunk;
+    } else {
+      prev->next = chunk;
+    }
+  }
+  _scratch.current = chunk;
+  _scratch.next = chunk->block + size;
+  _scratch.end = chunk->end;
+  return chunk->block;
+}
+
+ScratchMark scratch_mark() {
+  ScratchMark mark = {.chunk = _scratch.current, .next = _scratch.next};
+  return mark;
+}
+
+void scratch_reset(ScratchMark mark) {
+  if (NULL == mark.chunk) {
+    // Taken before anything was allocated.
+    _scratch.current = NULL;
+    _scratch.next = _scratch.end = NULL;
+    return;
+  }
+  _scratch.current = mark.chunk;
+  _scratch.next = mark.next;
+  _scratch.end = mark.chunk->end;
+}
+
+void *scratch_alloc(size_t size) {
+  size = _round_up(size);
+  if (size <= (size_t)(_scratch.end - _scratch.next)) {
+    void *ptr = _scratch.next;
+    _scratch.next += size;
+    return ptr;
+  }
+  return _scratch_alloc_slow(size);
+}
+
+void scratch_finalize() { _thread_scratch_free(&_scratch); }
@@ -0,0 +1,62 @@
+// scratch.h
+//
+// Created on: Oct 17, 2026
+//     Author: Jeff Manzione
+//
+// A per-thread bump allocator for short-lived temporaries.
+//
+// Allocating is a pointer bump, and everything allocated after a mark is
+// released at once by resetting to it. Marks nest, so a function can take a
+// mark on entry and reset to it on exit regardless of what its caller has
+// allocated.
+//
+// Usage:
+//   ScratchMark mark = scratch_mark();
+//   char *tmp = SCRATCH_ALLOC_ARRAY(char, len + 1);
+//   ...
+//   scratch_reset(mark);
+
+#ifndef ALLOC_SCRATCH_SCRATCH_H_
+#define ALLOC_SCRATCH_SCRATCH_H_
+
+#include <stddef.h>
+
+typedef struct __ScratchChunk _ScratchChunk;
+
+// A position in the calling thread's scratch space.
+typedef struct {
+  _ScratchChunk *chunk;
+  char *next;
+} ScratchMark;
+
+// Returns the current position in the calling thread's scratch space.
+ScratchMark scratch_mark();
+
+// Releases everything the calling thread allocated since [mark] was taken.
+//
+// Details:
+//   - [mark] must have been taken on the calling thread. Marks are reset to
+//     in the reverse of the order they were taken, like a stack.
+//   - The memory is kept for reuse by later scratch allocations.
+void scratch_reset(ScratchMark mark);
+
+// Allocates [size] bytes of scratch space aligned like malloc().
+//
+// Details:
+//   - The memory is not cleared.
+//   - Only valid on the calling thread until scratch_reset() is called with
+//     an earlier mark.
+void *scratch_alloc(size_t size);
+
+// Allocates scratch space for [count] elements of [type]. See scratch_alloc().
+//
+// Usage:
+//   MyStruct *arr = SCRATCH_ALLOC_ARRAY(MyStruct, 20);
+#define SCRATCH_ALLOC_ARRAY(type, count) \
+  (type *)scratch_alloc(sizeof(type) * (count))
+
+// Frees the calling thread's scratch space. This happens automatically when a
+// thread exits.
+void scratch_finalize();
+
+#endif /* ALLOC_SCRATCH_SCRATCH_H_ */
@@ -0,0 +1,264 @@
+// site.c
+//
+// Created on: Oct 17, 2026
+//     Author: Jeff Manzione
+
+#include "alloc/site.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "debug/debug.h"
+#include "util/util.h"
+
+// Kept at most half full so that probe sequences stay short.
+#define SITE_TABLE_SZ (ALLOC_MAX_SITES * 2)
+// Slots searched in _site_addrs before giving up on caching a site there.
+#define SITE_ADDR_MAX_PROBES 16
+
+typedef struct {
+  AllocSite site;
+  _Atomic uint64_t alloc_count, free_count, alloc_bytes, live_bytes,
+      peak_bytes;
+} _SiteEntry;
+
+// Sites indexed by id - 1.
+static _SiteEntry _sites[ALLOC_MAX_SITES];
+// Open-addressed index of site ids. 0 marks an empty slot.
+static _Atomic uint32_t _site_index[SITE_TABLE_SZ];
+static _Atomic uint32_t _site_count = 0;
+// Serializes registration of new sites. Lookups do not need it.
+static pthread_mutex_t _site_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// A site as the addresses of its strings, for alloc_site_intern_static(). The
+// fields are written under _site_lock before [id] is published.
+typedef struct {
+  _Atomic uint32_t id;
+  uint32_t line;
+  const char *func, *file, *type_name;
+} _SiteAddr;
+
+// Open-addressed cache from string addresses to site ids. Several entries may
+// share an id when the linker did not pool identical strings.
+static _SiteAddr _site_addrs[SITE_TABLE_SZ];
+
+static inline uint32_t _site_hash(uint32_t line, const char func[],
+                                  const char file[], const char type_name[]) {
+  uint64_t h = line;
+  h = (h * 0x9E3779B97F4A7C15ull) ^ string_hasher(func);
+  h = (h * 0x9E3779B97F4A7C15ull) ^ string_hasher(file);
+  h = (h * 0x9E3779B97F4A7C15ull) ^ string_hasher(type_name);
+  h *= 0x9E3779B97F4A7C15ull;
+  return (uint32_t)(h >> 32);
+}
+
+// Returns true if [str] has the same contents as [site_str]. Strings passed
+// back in from an AllocSite are the same pointer, so skip comparing those.
+static inline bool _site_str_eq(const char site_str[], const char str[]) {
+  return site_str == str || 0 == strcmp(site_str, str);
+}
+
+static inline bool _site_matches(const _SiteEntry *entry, uint32_t line,
+                                 const char func[], const char file[],
+                                 const char type_name[]) {
+  return entry->site.line == line && _site_str_eq(entry->site.func, func) &&
+         _site_str_eq(entry->site.file, file) &&
+         _site_str_eq(entry->site.type_name, type_name);
+}
+
+static inline uint32_t _site_addr_hash(uint32_t line, const char func[],
+                                       const char file[],
+                                       const char type_name[]) {
+  uint64_t h = line;
+  h = (h * 0x9E3779B97F4A7C15ull) ^ (uintptr_t)func;
+  h = (h * 0x9E3779B97F4A7C15ull) ^ (uintptr_t)file;
+  h = (h * 0x9E3779B97F4A7C15ull) ^ (uintptr_t)type_name;
+  h *= 0x9E3779B97F4A7C15ull;
+  return (uint32_t)(h >> 32);
+}
+
+// Returns the id cached for these exact strings, or ALLOC_NO_SITE. If [slot]
+// is not NULL, it is set to the empty slot where they would be cached or to
+// SITE_TABLE_SZ if there is none close enough.
+static uint32_t _site_addr_find(uint32_t hval, uint32_t line,
+                                const char func[], const char file[],
+                                const char type_name[], uint32_t *slot) {
+  uint32_t i = hval % SITE_TABLE_SZ;
+  for (int probes = 0; probes < SITE_ADDR_MAX_PROBES; ++probes) {
+    _SiteAddr *addr = &_site_addrs[i];
+    uint32_t id = atomic_load_explicit(&addr->id, memory_order_acquire);
+    if (ALLOC_NO_SITE == id) {
+      if (NULL != slot) {
+        *slot = i;
+      }
+      return ALLOC_NO_SITE;
+    }
+    if (addr->line == line && addr->func == func && addr->file == file &&
+        addr->type_name == type_name) {
+      return id;
+    }
+    i = (i + 1) % SITE_TABLE_SZ;
+  }
+  if (NULL != slot) {
+    *slot = SITE_TABLE_SZ;
+  }
+  return ALLOC_NO_SITE;
+}
+
+static char *_copy(const char str[]) {
+  size_t len = strlen(str);
+  char *cpy = malloc(len + 1);
+  ASSERT_NOT_NULL(cpy);
+  memcpy(cpy, str, len + 1);
+  return cpy;
+}
+
+// Returns the id of the matching site, or ALLOC_NO_SITE with [slot] set to the
+// empty slot where it would be inserted.
+static uint32_t _site_find(uint32_t hval, uint32_t line, const char func[],
+                           const char file[], const char type_name[],
+                           uint32_t *slot) {
+  uint32_t i = hval % SITE_TABLE_SZ;
+  while (true) {
+    uint32_t id = atomic_load_explicit(&_site_index[i], memory_order_acquire);
+    if (ALLOC_NO_SITE == id) {
+      *slot = i;
+      return ALLOC_NO_SITE;
+    }
+    if (_site_matches(&_sites[id - 1], line, func, file, type_name)) {
+      return id;
+    }
+    i = (i + 1) % SITE_TABLE_SZ;
+  }
+}
+
+uint32_t alloc_site_intern(uint32_t line, const char func[], const char file[],
+                           const char type_name[]) {
+  uint32_t hval = _site_hash(line, func, file, type_name);
+  uint32_t slot;
+  uint32_t id = _site_find(hval, line, func, file, type_name, &slot);
+  if (ALLOC_NO_SITE != id) {
+    return id;
+  }
+  pthread_mutex_lock(&_site_lock);
+  // Another thread may have registered the site while waiting on the lock.
+  id = _site_find(hval, line, func, file, type_name, &slot);
+  if (ALLOC_NO_SITE == id) {
+    uint32_t count = atomic_load_explicit(&_site_count, memory_order_relaxed);
+    if (count >= ALLOC_MAX_SITES) {
+      pthread_mutex_unlock(&_site_lock);
+      __error(line, func, file, "Exceeded the maximum of %d allocation sites.",
+              ALLOC_MAX_SITES);
+    }
+    _SiteEntry *entry = &_sites[count];
+    entry->site.line = line;
+    entry->site.func = _copy(func);
+    entry->site.file = _copy(file);
+    entry->site.type_name = _copy(type_name);
+    id = count + 1;
+    atomic_store_explicit(&_site_count, id, memory_order_release);
+    atomic_store_explicit(&_site_index[slot], id, memory_order_release);
+  }
+  pthread_mutex_unlock(&_site_lock);
+  return id;
+}
+
+uint32_t alloc_site_intern_static(uint32_t line, const char func[],
+                                  const char file[], const char type_name[]) {
+  uint32_t hval = _site_addr_hash(line, func, file, type_name);
+  uint32_t id = _site_addr_find(hval, line, func, file, type_name, NULL);
+  if (ALLOC_NO_SITE != id) {
+    return id;
+  }
+  id = alloc_site_intern(line, func, file, type_name);
+  pthread_mutex_lock(&_site_lock);
+  uint32_t slot;
+  if (ALLOC_NO_SITE ==
+          _site_addr_find(hval, line, func, file, type_name, &slot) &&
+      slot < SITE_TABLE_SZ) {
+    _SiteAddr *addr = &_site_addrs[slot];
+    addr->line = line;
+    addr->func = func;
+    addr->file = file;
+    addr->type_name = type_name;
+    atomic_store_explicit(&addr->id, id, memory_order_release);
+  }
+  pthread_mutex_unlock(&_site_lock);
+  return id;
+}
+
+const AllocSite *alloc_site(uint32_t site_id) {
+  if (ALLOC_NO_SITE == site_id ||
+      site_id > atomic_load_explicit(&_site_count, memory_order_acquire)) {
+    return NULL;
+  }
+  return &_sites[site_id - 1].site;
+}
+
+void alloc_site_record_alloc(uint32_t site_id, uint64_t bytes, uint64_t count) {
+  ASSERT(NOT_NULL(alloc_site(site_id)));
+  _SiteEntry *entry = &_sites[site_id - 1];
+  atomic_fetch_add_explicit(&entry->alloc_count, count, memory_order_relaxed);
+  atomic_fetch_add_explicit(&entry->alloc_bytes, bytes, memory_order_relaxed);
+  uint64_t live = bytes + atomic_fetch_add_explicit(&entry->live_bytes, bytes,
+                                                    memory_order_relaxed);
+  uint64_t peak =
+      atomic_load_explicit(&entry->peak_bytes, memory_order_relaxed);
+  while (live > peak &&
+         !atomic_compare_exchange_weak_explicit(&entry->peak_bytes, &peak, live,
+                                                memory_order_relaxed,
+                                                memory_order_relaxed)) {
+  }
+}
+
+void alloc_site_record_free(uint32_t site_id, uint64_t bytes, uint64_t count) {
+  ASSERT(NOT_NULL(alloc_site(site_id)));
+  _SiteEntry *entry = &_sites[site_id - 1];
+  atomic_fetch_add_explicit(&entry->free_count, count, memory_order_relaxed);
+  atomic_fetch_sub_explicit(&entry->live_bytes, bytes, memory_order_relaxed);
+}
+
+AllocSiteStats alloc_site_stats(uint32_t site_id) {
+  AllocSiteStats stats = {0};
+  if (NULL == alloc_site(site_id)) {
+    return stats;
+  }
+  _SiteEntry *entry = &_sites[site_id - 1];
+  stats.alloc_count =
+      atomic_load_explicit(&entry->alloc_count, memory_order_relaxed);
+  stats.free_count =
+      atomic_load_explicit(&entry->free_count, memory_order_relaxed);
+  stats.alloc_bytes =
+      atomic_load_explicit(&entry->alloc_bytes, memory_order_relaxed);
+  stats.live_bytes =
+      atomic_load_explicit(&entry->live_bytes, memory_order_relaxed);
+  stats.peak_bytes =
+      atomic_load_explicit(&entry->peak_bytes, memory_order_relaxed);
+  return stats;
+}
+
+uint32_t alloc_site_count() {
+  return atomic_load_explicit(&_site_count, memory_order_acquire);
+}
+
+void alloc_site_finalize() {
+  pthread_mutex_lock(&_site_lock);
+  uint32_t count = atomic_load_explicit(&_site_count, memory_order_relaxed);
+  for (uint32_t i = 0; i < count; ++i) {
+    free((char *)_sites[i].site.func);
+    free((char *)_sites[i].site.file);
+    free((char *)_sites[i].site.type_name);
+  }
+  memset(_sites, 0, sizeof(_SiteEntry) * count);
+  for (uint32_t i = 0; i < SITE_TABLE_SZ; ++i) {
+    atomic_store_explicit(&_site_index[i], ALLOC_NO_SITE,
+                          memory_order_relaxed);
+    atomic_store_explicit(&_site_addrs[i].id, ALLOC_NO_SITE,
+                          memory_order_relaxed);
+  }
+  atomic_store_explicit(&_site_count, 0, memory_order_release);
+  pthread_mutex_unlock(&_site_lock);
+}
@@ -0,0 +1,93 @@
+// site.h
+//
+// Created on: Oct 17, 2026
+//     Author: Jeff Manzione
+//
+// Interns allocation call sites so that tracked blocks can refer to where they
+// were allocated with a compact id instead of owning copies of the strings.
+//
+// Each unique (line, func, file, type_name) tuple is registered once and is
+// assigned a small sequential id. Lookups by id and repeat interning of an
+// existing site are lock-free.
+
+#ifndef ALLOC_SITE_H_
+#define ALLOC_SITE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Maximum number of distinct call sites that can be interned.
+#define ALLOC_MAX_SITES (1 << 14)
+
+// Id which is never assigned to a site.
+#define ALLOC_NO_SITE 0
+
+// Where an allocation came from.
+typedef struct {
+  uint32_t line;
+  const char *type_name;
+  const char *func;
+  const char *file;
+} AllocSite;
+
+// Running totals for the blocks attributed to a site.
+typedef struct {
+  uint64_t alloc_count;
+  uint64_t free_count;
+  uint64_t alloc_bytes;
+  uint64_t live_bytes;
+  // Highest value that live_bytes has reached.
+  uint64_t peak_bytes;
+} AllocSiteStats;
+
+// Returns the id for the call site, registering it if it has not been seen
+// before.
+//
+// Details:
+//   - Sites are identified by the contents of [func], [file], and
+//     [type_name], so they need not be string literals and may be reused
+//     once this returns.
+//   - The strings are copied the first time a site is seen.
+uint32_t alloc_site_intern(uint32_t line, const char func[], const char file[],
+                           const char type_name[]);
+
+// Like alloc_site_intern(), but for strings that live until
+// alloc_site_finalize() and never change, such as string literals and
+// __func__.
+//
+// Details:
+//   - Looks the site up by the addresses of the strings first, which skips
+//     hashing and comparing their contents. Falls back to alloc_site_intern()
+//     on a miss, so copies of the same string at different addresses still
+//     share a site.
+uint32_t alloc_site_intern_static(uint32_t line, const char func[],
+                                  const char file[], const char type_name[]);
+
+// Returns the site associated with [site_id] or NULL if no such site exists.
+const AllocSite *alloc_site(uint32_t site_id);
+
+// Returns the number of sites that have been interned. Site ids are in the
+// range [1, alloc_site_count()].
+uint32_t alloc_site_count();
+
+// Records that [count] blocks totalling [bytes] were allocated at [site_id].
+//
+// A count other than 1 is used when a sampled block stands in for the
+// unsampled allocations around it.
+void alloc_site_record_alloc(uint32_t site_id, uint64_t bytes, uint64_t count);
+
+// Records that [count] blocks totalling [bytes] allocated at [site_id] were
+// freed.
+void alloc_site_record_free(uint32_t site_id, uint64_t bytes, uint64_t count);
+
+// Returns a snapshot of the totals for [site_id].
+//
+// Details:
+//   - Each field is read atomically, but the fields are not read together, so
+//     they may be momentarily inconsistent while other threads allocate.
+AllocSiteStats alloc_site_stats(uint32_t site_id);
+
+// Frees all interned sites. All previously returned ids are invalidated.
+void alloc_site_finalize();
+
+#endif /* ALLOC_SITE_H_ */
@@ -0,0 +1,293 @@
+// slab.c
+//
+// Created on: Oct 17, 2026
+//     Author: Jeff Manzione
+
+#include "alloc/slab/slab.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#define SPAN_SZ (64 * 1024)
+// The first cache line of each span holds its _SpanHeader.
+#define SPAN_HEADER_SZ 64
+// Address space reserved for spans up front. Only spans in use are backed by
+// memory. Reserving it in one piece means that a pointer can be identified as
+// a slab object with a single range check.
+#define REGION_SZ ((uintptr_t)64 * 1024 * 1024 * 1024)
+#define NUM_SIZE_CLASSES 20
+// Approximate bytes of objects moved between a thread and a shared pool at
+// once.
+#define BATCH_BYTES (8 * 1024)
+#define MIN_BATCH_SZ 4
+#define MAX_BATCH_SZ 64
+
+// 16-byte steps up to 128, then 4 steps per power of 2.
+static const uint32_t _CLASS_SIZES[NUM_SIZE_CLASSES] = {
+    16,  32,  48,  64,  80,  96,  112, 128, 160, 192,
+    224, 256, 320, 384, 448, 512, 640, 768, 896, 1024};
+
+typedef struct {
+  uint32_t size_class;
+} _SpanHeader;
+
+typedef struct __FreeObject _FreeObject;
+struct __FreeObject {
+  _FreeObject *next;
+  // Only set on the first object of a batch held by a _SharedPool.
+  _FreeObject *next_batch;
+};
+
+// Objects of one size class shared by all threads.
+typedef struct {
+  _Alignas(64) pthread_mutex_t lock;
+  // Batches returned by threads, linked by next_batch.
+  _FreeObject *batches;
+  // Remainder of the span that new objects are carved from.
+  char *carve_next, *carve_end;
+} _SharedPool;
+
+typedef struct {
+  _FreeObject *head;
+  uint32_t count;
+} _ThreadList;
+
+typedef struct {
+  // True once the thread's destructor has been set up.
+  bool registered;
+  _ThreadList lists[NUM_SIZE_CLASSES];
+} _ThreadCache;
+
+static pthread_once_t _init_once = PTHREAD_ONCE_INIT;
+// Used only for its destructor, which flushes a thread's cache on exit.
+static pthread_key_t _thread_key;
+// The reserved region. Both NULL if it could not be reserved, in which case
+// every allocation goes to libc.
+static char *_region_start = NULL, *_region_end = NULL;
+// Where the next span will be taken from.
+static atomic_uintptr_t _region_next;
+static _SharedPool _pools[NUM_SIZE_CLASSES];
+static uint32_t _batch_sz[NUM_SIZE_CLASSES];
+static __thread _ThreadCache _cache;
+
+static inline int _size_class(size_t size) {
+  if (size <= 128) {
+    return 0 == size ? 0 : (size - 1) / 16;
+  }
+  size_t s = size - 1;
+  int log2 = 63 - __builtin_clzll(s);
+  return 8 + (log2 - 7) * 4 + ((s >> (log2 - 2)) & 3);
+}
+
+static inline bool _in_region(const void *ptr) {
+  return (uintptr_t)ptr - (uintptr_t)_region_start <
+         (uintptr_t)(_region_end - _region_start);
+}
+
+static inline _SpanHeader *_span_of(const void *ptr) {
+  return (_SpanHeader *)((uintptr_t)ptr & ~(uintptr_t)(SPAN_SZ - 1));
+}
+
+// Moves the first [n] objects of [list] to the shared pool as one batch.
+static void _thread_list_release(_ThreadList *list, int size_class,
+                                 uint32_t n) {
+  _FreeObject *batch = list->head, *tail = batch;
+  for (uint32_t i = 1; i < n; ++i) {
+    tail = tail->next;
+  }
+  list->head = tail->next;
+  list->count -= n;
+  tail->next = NULL;
+
+  _SharedPool *pool = &_pools[size_class];
+  pthread_mutex_lock(&pool->lock);
+  batch->next_batch = pool->batches;
+  pool->batches = batch;
+  pthread_mutex_unlock(&pool->lock);
+}
+
+// Returns everything in an exiting thread's cache to the shared pools.
+static void _thread_cache_flush(void *arg) {
+  _ThreadCache *cache = (_ThreadCache *)arg;
+  for (int i = 0; i < NUM_SIZE_CLASSES; ++i) {
+    if (cache->lists[i].count > 0) {
+      _thread_list_release(&cache->lists[i], i, cache->lists[i].count);
+    }
+  }
+  cache->registered = false;
+}
+
+static inline void _thread_cache_register() {
+  if (_cache.registered) {
+    return;
+  }
+  _cache.registered = true;
+  pthread_setspecific(_thread_key, &_cache);
+}
+
+static void _slab_init() {
+  for (int i = 0; i < NUM_SIZE_CLASSES; ++i) {
+    uint32_t batch_sz = BATCH_BYTES / _CLASS_SIZES[i];
+    _batch_sz[i] = batch_sz < MIN_BATCH_SZ   ? MIN_BATCH_SZ
+                   : batch_sz > MAX_BATCH_SZ ? MAX_BATCH_SZ
+                                             : batch_sz;
+    pthread_mutex_init(&_pools[i].lock, NULL);
+  }
+  pthread_key_create(&_thread_key, _thread_cache_flush);
+  void *region =
+      mmap(NULL, REGION_SZ + SPAN_SZ, PROT_NONE,
+           MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, /*fd=*/-1, 0);
+  if (MAP_FAILED == region) {
+    return;
+  }
+  uintptr_t start =
+      ((uintptr_t)region + SPAN_SZ - 1) & ~(uintptr_t)(SPAN_SZ - 1);
+  atomic_store(&_region_next, start);
+  _region_start = (char *)start;
+  _region_end = (char *)start + REGION_SZ;
+}
+
+// Commits the next span in the region to [size_class]. Returns NULL if the
+// region is used up.
+static char *_span_acquire(int size_class) {
+  uintptr_t span = atomic_fetch_add(&_region_next, SPAN_SZ);
+  if (span + SPAN_SZ > (uintptr_t)_region_end ||
+      0 != mprotect((void *)span, SPAN_SZ, PROT_READ | PROT_WRITE)) {
+    return NULL;
+  }
+  ((_SpanHeader *)span)->size_class = size_class;
+  return (char *)span;
+}
+
+// Carves up to a batch of new objects from [pool]'s span. Must hold the pool's
+// lock.
+static _FreeObject *_shared_pool_carve(_SharedPool *pool, int size_class) {
+  uint32_t obj_sz = _CLASS_SIZES[size_class];
+  if (pool->carve_next + obj_sz > pool->carve_end) {
+    char *span = _span_acquire(size_class);
+    if (NULL == span) {
+      return NULL;
+    }
+    pool->carve_next = span + SPAN_HEADER_SZ;
+    pool->carve_end = span + SPAN_SZ;
+  }
+  _FreeObject *head = NULL, **tail = &head;
+  for (uint32_t i = 0; i < _batch_sz[size_class] &&
+                       pool->carve_next + obj_sz <= pool->carve_end;
+       ++i) {
+    _FreeObject *obj = (_FreeObject *)pool->carve_next;
+    pool->carve_next += obj_sz;
+    *tail = obj;
+    tail = &obj->next;
+  }
+  *tail = NULL;
+  return head;
+}
+
+// Fills an empty [list] with a batch from the shared pool. Returns NULL if no
+// more objects can be made.
+static _FreeObject *_thread_list_refill(_ThreadList *list, int size_class) {
+  pthread_once(&_init_once, _slab_init);
+  if (NULL == _region_start) {
+    return NULL;
+  }
+  _thread_cache_register();
+  _SharedPool *pool = &_pools[size_class];
+  pthread_mutex_lock(&pool->lock);
+  _FreeObject *batch = pool->batches;
+  if (NULL != batch) {
+    pool->batches = batch->next_batch;
+  } else {
+    batch = _shared_pool_carve(pool, size_class);
+  }
+  pthread_mutex_unlock(&pool->lock);
+
+  uint32_t count = 0;
+  for (_FreeObject *obj = batch; NULL != obj; obj = obj->next) {
+    ++count;
+  }
+  list->head = batch;
+  list->count = count;
+  return batch;
+}
+
+static void *_slab_malloc(size_t size) {
+  if (size > SLAB_MAX_OBJECT_SZ) {
+    return malloc(size);
+  }
+  int size_class = _size_class(size);
+  _ThreadList *list = &_cache.lists[size_class];
+  _FreeObject *obj = list->head;
+  if (NULL == obj && NULL == (obj = _thread_list_refill(list, size_class))) {
+    return malloc(size);
+  }
+  list->head = obj->next;
+  --list->count;
+  return obj;
+}
+
+static void *_slab_calloc(size_t count, size_t size) {
+  size_t total;
+  if (__builtin_mul_overflow(count, size, &total)) {
+    return NULL;
+  }
+  if (total > SLAB_MAX_OBJECT_SZ) {
+    return calloc(count, size);
+  }
+  void *ptr = _slab_malloc(total);
+  if (NULL != ptr) {
+    memset(ptr, 0, total);
+  }
+  return ptr;
+}
+
+static void _slab_free(void *ptr) {
+  if (!_in_region(ptr)) {
+    free(ptr);
+    return;
+  }
+  int size_class = _span_of(ptr)->size_class;
+  _ThreadList *list = &_cache.lists[size_class];
+  if (NULL == list->head) {
+    // Objects freed by a thread that never allocated from this size class
+    // still need to be returned when it exits.
+    _thread_cache_register();
+  }
+  _FreeObject *obj = (_FreeObject *)ptr;
+  obj->next = list->head;
+  list->head = obj;
+  if (++list->count >= 2 * _batch_sz[size_class]) {
+    _thread_list_release(list, size_class, _batch_sz[size_class]);
+  }
+}
+
+static void *_slab_realloc(void *ptr, size_t size) {
+  if (NULL == ptr) {
+    return _slab_malloc(size);
+  }
+  if (!_in_region(ptr)) {
+    return realloc(ptr, size);
+  }
+  uint32_t old_size = _CLASS_SIZES[_span_of(ptr)->size_class];
+  if (size <= old_size) {
+    return ptr;
+  }
+  void *new_ptr = _slab_malloc(size);
+  if (NULL == new_ptr) {
+    return NULL;
+  }
+  memcpy(new_ptr, ptr, old_size);
+  _slab_free(ptr);
+  return new_ptr;
+}
+
+const AllocBackend ALLOC_SLAB_BACKEND = {.name = "slab",
+                                         .calloc = _slab_calloc,
+                                         .malloc = _slab_malloc,
+                                         .realloc = _slab_realloc,
+                                         .free = _slab_free};
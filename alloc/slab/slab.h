@@ -0,0 +1,35 @@
+// slab.h
+//
+// Created on: Oct 17, 2026
+//     Author: Jeff Manzione
+//
+// A size-class allocator for small objects with per-thread caches.
+//
+// Objects up to SLAB_MAX_OBJECT_SZ bytes are carved from 64 KiB spans, one
+// size class per span. Each thread keeps a free list per size class, so most
+// allocations and frees are a pointer pop or push with no locking. Threads
+// trade objects with a shared pool per size class in batches, which is also
+// how objects freed by a different thread than the one that allocated them
+// find their way back. Larger objects go to libc.
+//
+// Usage:
+//   alloc_init_with_backend(&ALLOC_SLAB_BACKEND);
+//   MyStruct *s = ALLOC(MyStruct);
+//   DEALLOC(s);
+
+#ifndef ALLOC_SLAB_SLAB_H_
+#define ALLOC_SLAB_SLAB_H_
+
+#include "alloc/alloc.h"
+
+// Largest object served from a size class.
+#define SLAB_MAX_OBJECT_SZ 1024
+
+// The slab allocator. See alloc_init_with_backend().
+//
+// Details:
+//   - Spans are never returned to the OS, though their objects are reused.
+//   - Threads return their cached objects to the shared pools on exit.
+extern const AllocBackend ALLOC_SLAB_BACKEND;
+
+#endif /* ALLOC_SLAB_SLAB_H_ */
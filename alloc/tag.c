@@ -0,0 +1,198 @@
+// tag.c
+//
+// Created on: Oct 17, 2026
+//     Author: Jeff Manzione
+
+#include "alloc/tag.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// How far a thread's unflushed count for a tag may drift before it is added to
+// the shared count. Bounds how late a budget can be noticed.
+#define TAG_FLUSH_BYTES (64 * 1024)
+
+typedef struct {
+  // NULL if the tag has not been registered.
+  const char *name;
+  // Bytes flushed by all threads, including those that have exited.
+  _Atomic int64_t bytes;
+  // 0 if there is no budget.
+  _Atomic size_t soft_budget, hard_budget;
+  // True while over the soft budget, so that crossing it is reported once.
+  atomic_bool over_soft;
+} _Tag;
+
+// A thread's unflushed bytes for each tag. Written only by its thread, but
+// read by alloc_tag_bytes() on others.
+typedef struct __ThreadTags _ThreadTags;
+struct __ThreadTags {
+  _Atomic int64_t unflushed[ALLOC_MAX_TAGS];
+  _ThreadTags *prev, *next;
+};
+
+static _Tag _tags[ALLOC_MAX_TAGS] = {[ALLOC_TAG_NONE] = {.name = "untagged"}};
+static _Atomic uint32_t _tag_count = 1;
+static _Atomic(AllocBudgetCallback) _budget_callback = NULL;
+// Guards registering tags and the list of threads.
+static pthread_mutex_t _tag_lock = PTHREAD_MUTEX_INITIALIZER;
+static _ThreadTags *_threads = NULL;
+static pthread_once_t _key_once = PTHREAD_ONCE_INIT;
+// Used only for its destructor, which flushes a thread's counts on exit.
+static pthread_key_t _key;
+
+static __thread AllocTag _current_tag = ALLOC_TAG_NONE;
+static __thread _ThreadTags *_thread_tags = NULL;
+
+static void _tag_budget_check(AllocTag tag, int64_t bytes) {
+  _Tag *entry = &_tags[tag];
+  size_t soft = atomic_load_explicit(&entry->soft_budget, memory_order_relaxed);
+  size_t hard = atomic_load_explicit(&entry->hard_budget, memory_order_relaxed);
+  if (0 == soft && 0 == hard) {
+    return;
+  }
+  AllocBudgetCallback callback = atomic_load(&_budget_callback);
+  if (0 != hard && bytes > (int64_t)hard) {
+    if (NULL != callback) {
+      callback(tag, /*hard=*/true, bytes, hard);
+    } else {
+      fprintf(stderr,
+              "Tag '%s' holds %ld bytes, over its hard budget of %zu.\n",
+              entry->name, (long)bytes, hard);
+    }
+  }
+  if (0 == soft) {
+    return;
+  }
+  if (bytes <= (int64_t)soft) {
+    atomic_store_explicit(&entry->over_soft, false, memory_order_relaxed);
+  } else if (!atomic_exchange(&entry->over_soft, true)) {
+    if (NULL != callback) {
+      callback(tag, /*hard=*/false, bytes, soft);
+    } else {
+      fprintf(stderr,
+              "Tag '%s' holds %ld bytes, over its soft budget of %zu.\n",
+              entry->name, (long)bytes, soft);
+    }
+  }
+}
+
+static void _tag_flush(AllocTag tag, int64_t delta) {
+  int64_t bytes = atomic_fetch_add(&_tags[tag].bytes, delta) + delta;
+  _tag_budget_check(tag, bytes);
+}
+
+static void _thread_tags_delete(void *arg) {
+  _ThreadTags *tags = (_ThreadTags *)arg;
+  pthread_mutex_lock(&_tag_lock);
+  for (int i = 0; i < ALLOC_MAX_TAGS; ++i) {
+    int64_t delta = atomic_load(&tags->unflushed[i]);
+    if (0 != delta) {
+      atomic_fetch_add(&_tags[i].bytes, delta);
+    }
+  }
+  if (NULL != tags->prev) {
+    tags->prev->next = tags->next;
+  } else {
+    _threads = tags->next;
+  }
+  if (NULL != tags->next) {
+    tags->next->prev = tags->prev;
+  }
+  pthread_mutex_unlock(&_tag_lock);
+  free(tags);
+  _thread_tags = NULL;
+}
+
+static void _key_create() { pthread_key_create(&_key, _thread_tags_delete); }
+
+static _ThreadTags *_thread_tags_create() {
+  pthread_once(&_key_once, _key_create);
+  _ThreadTags *tags = (_ThreadTags *)calloc(1, sizeof(_ThreadTags));
+  pthread_mutex_lock(&_tag_lock);
+  tags->next = _threads;
+  if (NULL != _threads) {
+    _threads->prev = tags;
+  }
+  _threads = tags;
+  pthread_mutex_unlock(&_tag_lock);
+  pthread_setspecific(_key, tags);
+  return _thread_tags = tags;
+}
+
+AllocTag alloc_tag_current() { return _current_tag; }
+
+void alloc_tag_record(AllocTag tag, int64_t delta) {
+  _ThreadTags *tags =
+      NULL == _thread_tags ? _thread_tags_create() : _thread_tags;
+  int64_t unflushed =
+      atomic_load_explicit(&tags->unflushed[tag], memory_order_relaxed) +
+      delta;
+  if (unflushed > TAG_FLUSH_BYTES || unflushed < -TAG_FLUSH_BYTES) {
+    _tag_flush(tag, unflushed);
+    unflushed = 0;
+  }
+  atomic_store_explicit(&tags->unflushed[tag], unflushed,
+                        memory_order_relaxed);
+}
+
+AllocTag alloc_tag_register(const char name[]) {
+  pthread_mutex_lock(&_tag_lock);
+  uint32_t count = atomic_load(&_tag_count);
+  for (uint32_t i = 1; i < count; ++i) {
+    if (0 == strcmp(_tags[i].name, name)) {
+      pthread_mutex_unlock(&_tag_lock);
+      return i;
+    }
+  }
+  if (count == ALLOC_MAX_TAGS) {
+    pthread_mutex_unlock(&_tag_lock);
+    return ALLOC_TAG_NONE;
+  }
+  char *cpy = malloc(strlen(name) + 1);
+  strcpy(cpy, name);
+  _tags[count].name = cpy;
+  atomic_store(&_tag_count, count + 1);
+  pthread_mutex_unlock(&_tag_lock);
+  return count;
+}
+
+const char *alloc_tag_name(AllocTag tag) {
+  return tag < atomic_load(&_tag_count) ? _tags[tag].name : NULL;
+}
+
+AllocTag alloc_tag_set(AllocTag tag) {
+  AllocTag prev = _current_tag;
+  _current_tag = tag < ALLOC_MAX_TAGS ? tag : ALLOC_TAG_NONE;
+  return prev;
+}
+
+int64_t alloc_tag_bytes(AllocTag tag) {
+  if (tag >= ALLOC_MAX_TAGS) {
+    return 0;
+  }
+  pthread_mutex_lock(&_tag_lock);
+  int64_t bytes = atomic_load(&_tags[tag].bytes);
+  for (_ThreadTags *tags = _threads; NULL != tags; tags = tags->next) {
+    bytes += atomic_load_explicit(&tags->unflushed[tag], memory_order_relaxed);
+  }
+  pthread_mutex_unlock(&_tag_lock);
+  return bytes;
+}
+
+void alloc_tag_set_budget(AllocTag tag, size_t soft_bytes, size_t hard_bytes) {
+  if (tag >= ALLOC_MAX_TAGS) {
+    return;
+  }
+  atomic_store(&_tags[tag].soft_budget, soft_bytes);
+  atomic_store(&_tags[tag].hard_budget, hard_bytes);
+  atomic_store(&_tags[tag].over_soft, false);
+}
+
+void alloc_set_budget_callback(AllocBudgetCallback callback) {
+  atomic_store(&_budget_callback, callback);
+}
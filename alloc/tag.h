@@ -0,0 +1,27 @@
+// tag.h
+//
+// Created on: Oct 17, 2026
+//     Author: Jeff Manzione
+//
+// Per-tag byte counts for the tags described in alloc/alloc.h.
+//
+// Each thread accumulates its changes to each tag locally and only adds them to
+// the shared count once they exceed TAG_FLUSH_BYTES in either direction, so
+// recording is a thread-local add in the common case. Budgets are checked
+// against the shared count when a thread flushes.
+
+#ifndef ALLOC_TAG_H_
+#define ALLOC_TAG_H_
+
+#include <stdint.h>
+
+#include "alloc/alloc.h"
+
+// Returns the calling thread's current tag.
+AllocTag alloc_tag_current();
+
+// Records that blocks totalling [delta] bytes were allocated (or freed if
+// negative) under [tag].
+void alloc_tag_record(AllocTag tag, int64_t delta);
+
+#endif /* ALLOC_TAG_H_ */
@@ -115,22 +115,6 @@ bool _map_insert_helper(Map *map, const void *key, const void *value,
         return false;
       }
     }
-    // Rob this entry if it did fewer probes.
-    if (me->num_probes < num_probes) {
-      _Entry tmp_me = *me;
-      // Take its spot.
-      me->pair.key = key;
-      me->pair.value = (void *)value;
-      me->hash_value = hval;
-      me->num_probes = num_probes;
-      // It is the new insertion.
-      key = tmp_me.pair.key;
-      value = tmp_me.pair.value;
-      hval = tmp_me.hash_value;
-      num_probes = tmp_me.num_probes;
-      first_empty = NULL;
-      num_probes_at_first_empty = -1;
-    }
   }
 }
 
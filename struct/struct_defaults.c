@@ -61,13 +61,13 @@ void __free_fn(void **ptr) { __dealloc(ptr, __LINE__, __func__, __FILE__); }
 #else
 
 void *__malloc_fn(size_t type_sz, size_t count, const char name[]) {
-  return malloc(count * type_sz);
+  return __alloc_backend->malloc(count * type_sz);
 }
 
 void *__calloc_fn(size_t type_sz, size_t count, const char name[]) {
-  return calloc(count, type_sz);
+  return __alloc_backend->calloc(count, type_sz);
 }
 
-void __free_fn(void **ptr) { free(*ptr); }
+void __free_fn(void **ptr) { __alloc_backend->free(*ptr); }
 
 #endif
\ No newline at end of file
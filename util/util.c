@@ -18,10 +18,16 @@
   (((x & 0x000000FF) == 0) || ((x & 0x0000FF00) == 0) || \
    ((x & 0x00FF0000) == 0) || ((x & 0xFF000000) == 0))
 
-uint32_t default_hasher(const void *ptr) { return (uint32_t)(intptr_t)ptr; }
+uint32_t default_hasher(const void *ptr) {
+  uint64_t val = (uint64_t)(uintptr_t)ptr;
+  return (uint32_t)(val ^ (val >> 32));
+}
 
 int32_t default_comparator(const void *ptr1, const void *ptr2) {
-  return ((intptr_t)ptr1) - ((intptr_t)ptr2);
+  // Pointers may differ by a multiple of 2^32, so the difference cannot simply
+  // be truncated.
+  return ((uintptr_t)ptr1 > (uintptr_t)ptr2) -
+         ((uintptr_t)ptr1 < (uintptr_t)ptr2);
 }
 
 uint32_t string_hasher(const void *ptr) {